@@ -8,18 +8,27 @@
 #include <pybind11/numpy.h>
 #include "strategy_metrics.hpp"
 #include "strategy_scoring.hpp"
+#include "strategy_session.hpp"
 #include <vector>
 #include <array>
 #include <iostream>
 #include <map>
 #include <mutex>
 #include <atomic>
+#include <optional>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <random>
+#include <chrono>
+#include <tuple>
 
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+
 namespace py = pybind11;
 
 using namespace strategy;
@@ -49,11 +58,634 @@ struct OptionsCache {
     size_t n_options;
     size_t pnl_length;
     bool valid;
+    
+    // Paires de même contrat (bitset de contract_words mots par option):
+    // deux jambes de ces options sont incompatibles si leurs signes sont opposés
+    std::vector<uint64_t> same_contract;
+    size_t contract_words = 0;
 };
 
 // Cache global (sera initialisé par Python)
 static OptionsCache g_cache;
 
+/**
+ * Indexe les paires d'options de même contrat (type, strike et échéance) du cache
+ */
+static void build_contract_index(OptionsCache& cache) {
+    const size_t n = cache.options.size();
+    cache.contract_words = (n + 63) / 64;
+    cache.same_contract.assign(n * cache.contract_words, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            if (same_contract(cache.options[i], cache.options[j])) {
+                cache.same_contract[i * cache.contract_words + j / 64] |= uint64_t{1} << (j % 64);
+            }
+        }
+    }
+}
+
+// Facteur de sur-échantillonnage du ranking quand les quasi-doublons sont filtrés
+static constexpr int NEAR_DEDUP_POOL_FACTOR = 4;
+
+// Facteur de sur-échantillonnage du rescore (doublons exacts retirés après recalcul)
+static constexpr int RESCORE_POOL_FACTOR = 2;
+
+// Facteur de sur-échantillonnage par groupe (doublons retirés groupe par groupe)
+static constexpr int GROUP_POOL_FACTOR = 2;
+
+// Marge relative des bornes du DFS (sommes dans un autre ordre que calculate)
+static constexpr double DFS_BOUND_SLACK = 1e-9;
+
+// Générateur de combinaisons
+enum class GeneratorMode {
+    MASKS,  // Toutes les combinaisons, puis leurs masques de signes autorisés
+    DFS,    // Jambe par jambe, sous-arbres coupés par intervalles (sans journal)
+    MITM,   // Jonction de demi-stratégies dans les fenêtres premium/delta (sans journal)
+    CLIQUE, // Cliques du graphe de compatibilité des jambes (sans journal)
+    BEAM    // Recherche heuristique anytime (beam search + recuit), non exhaustive
+};
+
+// Paramètres de la recherche heuristique (generator="beam")
+struct SearchParams {
+    int beam_width = 256;           // États gardés par profondeur
+    int anneal_chains = 16;         // Chaînes de recuit simulé (0 = beam seul)
+    int anneal_steps = 2000;        // Mouvements par chaîne
+    double temperature = 0.05;      // Température initiale, en unités de score
+    uint64_t seed = 0;              // Graine de la chaîne 0 (chaîne c: seed + c)
+    double time_limit = 0.0;        // Secondes, 0 = sans limite
+    std::vector<MetricConfig> objective;  // Métriques de l'objectif (vide = défaut)
+};
+
+DedupMode parse_dedup_mode(const std::string& name) {
+    if (name == "exact") return DedupMode::EXACT;
+    if (name == "linf") return DedupMode::NEAR_LINF;
+    if (name == "l2") return DedupMode::NEAR_L2;
+    throw std::invalid_argument("dedup_mode inconnu: " + name + " (exact, linf, l2)");
+}
+
+SelectionMode parse_selection_mode(const std::string& name) {
+    if (name == "top_n") return SelectionMode::TOP_N;
+    if (name == "mmr") return SelectionMode::MMR;
+    if (name == "pareto") return SelectionMode::PARETO;
+    if (name == "grouped") return SelectionMode::GROUPED;
+    throw std::invalid_argument("selection inconnue: " + name + " (top_n, mmr, pareto, grouped)");
+}
+
+GroupKey parse_group_key(const std::string& name) {
+    if (name == "n_legs") return GroupKey::N_LEGS;
+    if (name == "call_put") return GroupKey::CALL_PUT;
+    if (name == "structure") return GroupKey::STRUCTURE;
+    if (name == "expiry") return GroupKey::EXPIRY;
+    throw std::invalid_argument("group_by inconnu: " + name + " (n_legs, call_put, structure, expiry)");
+}
+
+GeneratorMode parse_generator_mode(const std::string& name) {
+    if (name == "masks") return GeneratorMode::MASKS;
+    if (name == "dfs") return GeneratorMode::DFS;
+    if (name == "mitm") return GeneratorMode::MITM;
+    if (name == "clique") return GeneratorMode::CLIQUE;
+    if (name == "beam") return GeneratorMode::BEAM;
+    throw std::invalid_argument("generator inconnu: " + name + " (masks, dfs, mitm, clique, beam)");
+}
+
+ExpiryPolicy parse_expiry_policy(const std::string& name, int max_expiries) {
+    if (name == "any") return {ExpiryMode::ANY, 0};
+    if (name == "single") return {ExpiryMode::SINGLE, 1};
+    if (name == "calendar") return {ExpiryMode::CALENDAR, 2};
+    if (name == "at_most") {
+        if (max_expiries < 1) {
+            throw std::invalid_argument("expiry_policy at_most: max_expiries >= 1 requis");
+        }
+        return {ExpiryMode::AT_MOST, max_expiries};
+    }
+    throw std::invalid_argument("expiry_policy inconnue: " + name + " (any, single, at_most, calendar)");
+}
+
+const char* expiry_mode_name(ExpiryMode mode) {
+    switch (mode) {
+        case ExpiryMode::SINGLE: return "single";
+        case ExpiryMode::AT_MOST: return "at_most";
+        case ExpiryMode::CALENDAR: return "calendar";
+        default: return "any";
+    }
+}
+
+/**
+ * Applique {"average_pnl": (lo, hi), ...} aux métriques: normaliseur FIXED
+ */
+void apply_fixed_ranges(const py::dict& fixed_ranges, std::vector<MetricConfig>& metrics) {
+    for (auto item : fixed_ranges) {
+        const std::string name = item.first.cast<std::string>();
+        const auto range = item.second.cast<std::pair<double, double>>();
+        auto it = std::find_if(metrics.begin(), metrics.end(),
+            [&name](const MetricConfig& metric) { return metric.name == name; });
+        if (it == metrics.end()) {
+            throw std::invalid_argument("fixed_ranges: métrique inconnue: " + name);
+        }
+        it->normalizer = NormalizerType::FIXED;
+        it->fixed_min = range.first;
+        it->fixed_max = range.second;
+    }
+}
+
+ScorerType parse_scorer(const std::string& name) {
+    if (name == "higher") return ScorerType::HIGHER_BETTER;
+    if (name == "lower") return ScorerType::LOWER_BETTER;
+    if (name == "moderate") return ScorerType::MODERATE_BETTER;
+    if (name == "positive") return ScorerType::POSITIVE_BETTER;
+    throw std::invalid_argument("scorer inconnu: " + name + " (higher, lower, moderate, positive)");
+}
+
+/**
+ * Ajoute {"pnl_per_risk": ("average_pnl / (1 + abs(max_loss))", 0.2[, "higher"]), ...}
+ * aux métriques: expressions compilées une fois, normaliseur MIN_MAX
+ */
+void add_custom_metrics(const py::dict& custom_metrics, std::vector<MetricConfig>& metrics) {
+    for (auto item : custom_metrics) {
+        const std::string name = item.first.cast<std::string>();
+        const py::tuple spec = item.second.cast<py::tuple>();
+        if (spec.size() != 2 && spec.size() != 3) {
+            throw std::invalid_argument("custom_metrics: (expression, poids[, scorer]) attendu pour " + name);
+        }
+        const bool exists = std::any_of(metrics.begin(), metrics.end(),
+            [&name](const MetricConfig& metric) { return metric.name == name; });
+        if (exists) {
+            throw std::invalid_argument("custom_metrics: nom déjà utilisé: " + name);
+        }
+        
+        const ScorerType scorer = spec.size() == 3
+            ? parse_scorer(spec[2].cast<std::string>())
+            : ScorerType::HIGHER_BETTER;
+        MetricConfig metric(name, spec[1].cast<double>(), NormalizerType::MIN_MAX, scorer);
+        metric.expression = std::make_shared<const MetricExpression>(spec[0].cast<std::string>());
+        metrics.push_back(std::move(metric));
+    }
+}
+
+/**
+ * Convertit {"min_open_interest": 100, "min_volume": 10, "min_quote_size": 5}
+ * en planchers de liquidité par jambe
+ */
+LiquidityFloors parse_liquidity(const py::dict& liquidity) {
+    LiquidityFloors floors;
+    for (auto item : liquidity) {
+        const std::string name = item.first.cast<std::string>();
+        const double value = item.second.cast<double>();
+        if (name == "min_open_interest") floors.min_open_interest = value;
+        else if (name == "min_volume") floors.min_volume = value;
+        else if (name == "min_quote_size") floors.min_quote_size = value;
+        else throw std::invalid_argument("liquidity: clé inconnue: " + name + " (min_open_interest, min_volume, min_quote_size)");
+    }
+    return floors;
+}
+
+SearchParams parse_search(const py::dict& search) {
+    SearchParams params;
+    for (auto item : search) {
+        const std::string name = item.first.cast<std::string>();
+        if (name == "beam_width") params.beam_width = item.second.cast<int>();
+        else if (name == "anneal_chains") params.anneal_chains = item.second.cast<int>();
+        else if (name == "anneal_steps") params.anneal_steps = item.second.cast<int>();
+        else if (name == "temperature") params.temperature = item.second.cast<double>();
+        else if (name == "seed") params.seed = item.second.cast<uint64_t>();
+        else if (name == "time_limit") params.time_limit = item.second.cast<double>();
+        else throw std::invalid_argument("search: clé inconnue: " + name +
+            " (beam_width, anneal_chains, anneal_steps, temperature, seed, time_limit)");
+    }
+    return params;
+}
+
+py::dict liquidity_to_py(const LiquidityFloors& floors) {
+    py::dict result;
+    result["min_open_interest"] = floors.min_open_interest;
+    result["min_volume"] = floors.min_volume;
+    result["min_quote_size"] = floors.min_quote_size;
+    return result;
+}
+
+LegConstraints parse_constraints(const py::dict& constraints) {
+    LegConstraints legs;
+    for (auto item : constraints) {
+        const std::string name = item.first.cast<std::string>();
+        if (name == "strike_min") legs.strike_min = item.second.cast<double>();
+        else if (name == "strike_max") legs.strike_max = item.second.cast<double>();
+        else if (name == "min_spacing") legs.min_spacing = item.second.cast<double>();
+        else if (name == "max_spacing") legs.max_spacing = item.second.cast<double>();
+        else if (name == "min_calls") legs.min_calls = item.second.cast<int>();
+        else if (name == "max_calls") legs.max_calls = item.second.cast<int>();
+        else if (name == "min_puts") legs.min_puts = item.second.cast<int>();
+        else if (name == "max_puts") legs.max_puts = item.second.cast<int>();
+        else if (name == "symmetric_wings") legs.symmetric_wings = item.second.cast<bool>();
+        else throw std::invalid_argument("constraints: clé inconnue: " + name +
+            " (strike_min, strike_max, min_spacing, max_spacing, min_calls, max_calls,"
+            " min_puts, max_puts, symmetric_wings)");
+    }
+    return legs;
+}
+
+py::dict constraints_to_py(const LegConstraints& legs) {
+    py::dict result;
+    result["strike_min"] = legs.strike_min;
+    result["strike_max"] = legs.strike_max;
+    result["min_spacing"] = legs.min_spacing;
+    result["max_spacing"] = legs.max_spacing;
+    result["min_calls"] = legs.min_calls;
+    result["max_calls"] = legs.max_calls;
+    result["min_puts"] = legs.min_puts;
+    result["max_puts"] = legs.max_puts;
+    result["symmetric_wings"] = legs.symmetric_wings;
+    return result;
+}
+
+NormalizerType parse_normalizer(const std::string& name) {
+    if (name == "max") return NormalizerType::MAX;
+    if (name == "min_max") return NormalizerType::MIN_MAX;
+    if (name == "count") return NormalizerType::COUNT;
+    if (name == "percentile") return NormalizerType::PERCENTILE;
+    if (name == "robust") return NormalizerType::ROBUST;
+    throw std::invalid_argument("normaliseur inconnu: " + name + " (max, min_max, count, percentile, robust)");
+}
+
+/**
+ * Applique {"avg_pnl_levrage": "percentile", ...} aux métriques
+ */
+void apply_normalizers(const py::dict& normalizers, std::vector<MetricConfig>& metrics) {
+    for (auto item : normalizers) {
+        const std::string name = item.first.cast<std::string>();
+        auto it = std::find_if(metrics.begin(), metrics.end(),
+            [&name](const MetricConfig& metric) { return metric.name == name; });
+        if (it == metrics.end()) {
+            throw std::invalid_argument("normalizers: métrique inconnue: " + name);
+        }
+        it->normalizer = parse_normalizer(item.second.cast<std::string>());
+    }
+}
+
+/**
+ * Le store de session garde les colonnes brutes des métriques par défaut:
+ * rescore() et refilter() ne reproduiraient ni les métriques personnalisées
+ * ni les normaliseurs du run, refusés avec keep_session
+ */
+void check_session_options(bool keep_session, bool has_custom_metrics, bool has_normalizers) {
+    if (!keep_session) {
+        return;
+    }
+    if (has_custom_metrics) {
+        throw std::invalid_argument("custom_metrics: incompatible avec keep_session");
+    }
+    if (has_normalizers) {
+        throw std::invalid_argument("normalizers: incompatible avec keep_session");
+    }
+}
+
+/**
+ * Convertit {"average_pnl": "max", "sigma_pnl": "min", ...} en objectifs Pareto
+ */
+std::vector<ObjectiveConfig> parse_objectives(const py::dict& objectives) {
+    std::vector<ObjectiveConfig> result;
+    for (auto item : objectives) {
+        const std::string name = item.first.cast<std::string>();
+        const std::string direction = item.second.cast<std::string>();
+        if (!StrategyScorer::is_known_metric(name)) {
+            throw std::invalid_argument("pareto_objectives: métrique inconnue: " + name);
+        }
+        if (direction != "max" && direction != "min") {
+            throw std::invalid_argument("Objectif " + name + ": direction 'max' ou 'min' attendue");
+        }
+        result.emplace_back(name, direction == "max");
+    }
+    return result;
+}
+
+DiversityMetric parse_diversity_metric(const std::string& name) {
+    if (name == "pnl") return DiversityMetric::PNL;
+    if (name == "legs") return DiversityMetric::LEGS;
+    throw std::invalid_argument("diversity inconnue: " + name + " (pnl, legs)");
+}
+
+// Noms Python des champs et opérateurs des règles de filtre
+static const std::pair<const char*, RuleField> RULE_FIELD_NAMES[] = {
+    {"premium", RuleField::PREMIUM},
+    {"abs_premium", RuleField::ABS_PREMIUM},
+    {"delta", RuleField::DELTA},
+    {"gamma", RuleField::GAMMA},
+    {"vega", RuleField::VEGA},
+    {"theta", RuleField::THETA},
+    {"implied_vol", RuleField::IMPLIED_VOL},
+    {"average_pnl", RuleField::AVERAGE_PNL},
+    {"roll", RuleField::ROLL},
+    {"roll_quarterly", RuleField::ROLL_QUARTERLY},
+    {"delta_levrage", RuleField::DELTA_LEVRAGE},
+    {"avg_pnl_levrage", RuleField::AVG_PNL_LEVRAGE},
+    {"n_legs", RuleField::N_LEGS},
+    {"call_legs", RuleField::CALL_LEGS},
+    {"put_legs", RuleField::PUT_LEGS},
+    {"max_profit", RuleField::MAX_PROFIT},
+    {"max_loss", RuleField::MAX_LOSS},
+    {"abs_max_loss", RuleField::ABS_MAX_LOSS},
+    {"max_loss_left", RuleField::MAX_LOSS_LEFT},
+    {"max_loss_right", RuleField::MAX_LOSS_RIGHT},
+    {"sigma_pnl", RuleField::SIGMA_PNL},
+    {"min_profit_price", RuleField::MIN_PROFIT_PRICE},
+    {"max_profit_price", RuleField::MAX_PROFIT_PRICE},
+    {"profit_zone_width", RuleField::PROFIT_ZONE_WIDTH},
+    {"n_breakevens", RuleField::N_BREAKEVENS},
+};
+
+static const std::pair<const char*, RuleOp> RULE_OP_NAMES[] = {
+    {"<", RuleOp::LT},
+    {"<=", RuleOp::LE},
+    {">", RuleOp::GT},
+    {">=", RuleOp::GE},
+    {"==", RuleOp::EQ},
+    {"!=", RuleOp::NE},
+};
+
+RuleField parse_rule_field(const std::string& name) {
+    for (const auto& [field_name, field] : RULE_FIELD_NAMES) {
+        if (name == field_name) return field;
+    }
+    throw std::invalid_argument("rules: champ inconnu: " + name);
+}
+
+RuleOp parse_rule_op(const std::string& name) {
+    for (const auto& [op_name, op] : RULE_OP_NAMES) {
+        if (name == op_name) return op;
+    }
+    throw std::invalid_argument("rules: opérateur inconnu: " + name + " (<, <=, >, >=, ==, !=)");
+}
+
+/**
+ * Convertit [("n_breakevens", "<=", 2), ("max_profit", ">=", 3.0, "abs_max_loss"), ...]
+ * en règles: (champ, op, valeur) ou (champ, op, facteur, champ2) = champ op facteur * champ2
+ */
+std::vector<FilterRule> parse_rules(const py::list& rules) {
+    std::vector<FilterRule> result;
+    for (const auto& item : rules) {
+        const py::tuple rule_tuple = item.cast<py::tuple>();
+        if (rule_tuple.size() != 3 && rule_tuple.size() != 4) {
+            throw std::invalid_argument("rules: (champ, op, valeur) ou (champ, op, facteur, champ2) attendu");
+        }
+        FilterRule rule;
+        rule.lhs = parse_rule_field(rule_tuple[0].cast<std::string>());
+        rule.op = parse_rule_op(rule_tuple[1].cast<std::string>());
+        if (rule_tuple.size() == 4) {
+            rule.has_rhs = true;
+            rule.factor = rule_tuple[2].cast<double>();
+            rule.rhs = parse_rule_field(rule_tuple[3].cast<std::string>());
+        } else {
+            rule.value = rule_tuple[2].cast<double>();
+        }
+        result.push_back(rule);
+    }
+    return result;
+}
+
+/**
+ * Règles compilées -> liste Python (format de parse_rules)
+ */
+py::list rules_to_py(const std::vector<FilterRule>& rules) {
+    auto field_name = [](RuleField field) {
+        for (const auto& [name, value] : RULE_FIELD_NAMES) {
+            if (value == field) return name;
+        }
+        return "";
+    };
+    auto op_name = [](RuleOp op) {
+        for (const auto& [name, value] : RULE_OP_NAMES) {
+            if (value == op) return name;
+        }
+        return "";
+    };
+    
+    py::list result;
+    for (const FilterRule& rule : rules) {
+        if (rule.has_rhs) {
+            result.append(py::make_tuple(field_name(rule.lhs), op_name(rule.op), rule.factor, field_name(rule.rhs)));
+        } else {
+            result.append(py::make_tuple(field_name(rule.lhs), op_name(rule.op), rule.value));
+        }
+    }
+    return result;
+}
+
+// Store de session du dernier run (keep_session=True)
+static SessionStore g_session;
+
+/**
+ * Métriques par défaut, poids éventuellement surchargés par custom_weights
+ * (liste vide = défauts de score_and_rank)
+ */
+std::vector<MetricConfig> build_metric_configs(const py::dict& custom_weights) {
+    std::vector<MetricConfig> metrics;
+    if (custom_weights.size() > 0) {
+
+        metrics = StrategyScorer::create_default_metrics();
+        for (auto& metric : metrics) {
+            if (custom_weights.contains(metric.name.c_str())) {
+                metric.weight = custom_weights[metric.name.c_str()].cast<double>();
+            }
+        }
+    }
+    return metrics;
+}
+
+/**
+ * Évalue une combinaison (indices dans le cache, signes) avec les filtres
+ * @param reject Optionnel: reçoit le motif et la valeur du rejet
+ * @param rules Optionnel: règles déclaratives compilées
+ * @return ScoredStrategy non scorée, ou nullopt si la stratégie est rejetée
+ */
+std::optional<ScoredStrategy> evaluate_combination(
+    const std::vector<int>& indices,
+    const std::vector<int>& combo_signs,
+    const FilterParams& filter,
+    RejectInfo* reject = nullptr,
+    const RuleProgram* rules = nullptr
+) {
+    const size_t n_legs = indices.size();
+    
+    // Politique d'échéances (avant toute copie des P&L)
+    if (filter.expiry.active()) {
+        const int n_expiries = StrategyCalculator::expiry_count(g_cache.options, indices);
+        if (n_expiries < filter.expiry.min_count() || n_expiries > filter.expiry.max_count()) {
+            if (reject) {
+                reject->reason = RejectReason::EXPIRY;
+                reject->value = static_cast<double>(n_expiries);
+            }
+            return std::nullopt;
+        }
+    }
+    
+    // Contraintes de structure (strikes et types des jambes)
+    if (filter.legs.active() && !StrategyCalculator::legs_within(g_cache.options, indices, filter.legs)) {
+        if (reject) {
+            reject->reason = RejectReason::STRUCTURE;
+            reject->value = 0.0;
+        }
+        return std::nullopt;
+    }
+    
+    // Planchers de liquidité par jambe
+    if (filter.liquidity.active()) {
+        for (size_t i = 0; i < n_legs; ++i) {
+            if (!StrategyCalculator::leg_liquid(g_cache.options[indices[i]], combo_signs[i], filter.liquidity)) {
+                if (reject) {
+                    reject->reason = RejectReason::LIQUIDITY;
+                    reject->value = static_cast<double>(i);
+                }
+                return std::nullopt;
+            }
+        }
+    }
+    
+    // Jambes shorts non couvertes: popcounts sur les masques, avant toute copie.
+    // Avec motif demandé, calculate garde son ordre (vente inutile et même option d'abord)
+    if (!reject) {
+        const LegMasks masks = StrategyCalculator::leg_masks(g_cache.options, indices, combo_signs);
+        if (masks.net_short_puts() > filter.ouvert_gauche || masks.net_short_calls() > filter.ouvert_droite) {
+            return std::nullopt;
+        }
+    }
+    
+    // Buffers locaux
+    std::vector<OptionData> combo_options;
+    std::vector<std::vector<double>> combo_pnl;
+    combo_options.reserve(n_legs);
+    combo_pnl.reserve(n_legs);
+
+    // Construire la combinaison
+    for (size_t i = 0; i < n_legs; ++i) {
+        int idx = indices[i];
+        combo_options.push_back(g_cache.options[idx]);
+        combo_pnl.push_back(g_cache.pnl_matrix[idx]);
+    }
+    
+    // Prix exécutables: premium ajusté par jambe, P&L décalé dans calculate
+    const double execution_cost = filter.execution.active()
+        ? StrategyCalculator::apply_execution(combo_options, combo_signs, filter.execution)
+        : 0.0;
+
+    // Calculer les métriques
+    auto result = StrategyCalculator::calculate(
+        combo_options, combo_signs, combo_pnl, g_cache.prices, g_cache.mixture,
+        g_cache.average_mix, filter.max_loss_left, filter.max_loss_right, filter.max_premium_params,
+        filter.ouvert_gauche, filter.ouvert_droite, filter.min_premium_sell,
+        filter.delta_min, filter.delta_max, filter.limit_left, filter.limit_right, reject, rules,
+        execution_cost
+    );
+    
+    if (!result.has_value()) {
+        return std::nullopt;
+    }
+    
+    const auto& metrics = result.value();
+    
+    ScoredStrategy strat;
+    strat.total_premium = metrics.total_premium;
+    strat.total_delta = metrics.total_delta;
+    strat.total_gamma = metrics.total_gamma;
+    strat.total_vega = metrics.total_vega;
+    strat.total_theta = metrics.total_theta;
+    strat.total_iv = metrics.total_iv;
+    strat.avg_implied_volatility = metrics.total_iv / n_legs;
+    strat.average_pnl = metrics.total_average_pnl;
+    strat.roll = metrics.total_roll;
+    strat.roll_quarterly = metrics.total_roll_quarterly;
+    strat.roll_sum = metrics.total_roll_sum;
+    strat.sigma_pnl = metrics.total_sigma_pnl;
+    strat.max_profit = metrics.max_profit;
+    strat.max_loss = std::min(metrics.max_loss_left, metrics.max_loss_right);
+    strat.max_loss_left = metrics.max_loss_left;
+    strat.max_loss_right = metrics.max_loss_right;
+    strat.min_profit_price = metrics.min_profit_price;
+    strat.max_profit_price = metrics.max_profit_price;
+    strat.profit_zone_width = metrics.profit_zone_width;
+    strat.call_count = metrics.call_count;
+    strat.put_count = metrics.put_count;
+    strat.breakeven_points = metrics.breakeven_points;
+    strat.total_pnl_array = metrics.total_pnl_array;
+    strat.avg_pnl_levrage = metrics.avg_pnl_levrage;
+    strat.delta_levrage = metrics.delta_levrage;
+    strat.liquidity = metrics.liquidity;
+    strat.payoff_key = metrics.payoff_key;
+    strat.call_legs = metrics.call_legs;
+    strat.put_legs = metrics.put_legs;
+    strat.structure = metrics.structure;
+    strat.expiry_set = metrics.expiry_set;
+    strat.option_indices = indices;
+    strat.signs = combo_signs;
+    
+    return strat;
+}
+
+/**
+ * Convertit les stratégies classées en liste Python de (indices, signes, métriques)
+ * @param group_key Mode GROUPED: ajoute le libellé du groupe ("group")
+ */
+py::list strategies_to_py(
+    const std::vector<ScoredStrategy>& strategies,
+    std::optional<GroupKey> group_key = std::nullopt
+) {
+    py::list results;
+    
+    for (const auto& strat : strategies) {
+        py::list indices_list;
+        py::list signs_list;
+        for (size_t i = 0; i < strat.option_indices.size(); ++i) {
+            indices_list.append(strat.option_indices[i]);
+            signs_list.append(strat.signs[i]);
+        }
+        
+        py::dict metrics_dict;
+        metrics_dict["total_premium"] = strat.total_premium;
+        metrics_dict["total_delta"] = strat.total_delta;
+        metrics_dict["total_gamma"] = strat.total_gamma;
+        metrics_dict["total_vega"] = strat.total_vega;
+        metrics_dict["total_theta"] = strat.total_theta;
+        metrics_dict["total_iv"] = strat.total_iv;
+        metrics_dict["avg_implied_volatility"] = strat.avg_implied_volatility;
+        metrics_dict["average_pnl"] = strat.average_pnl;
+        metrics_dict["total_average_pnl"] = strat.average_pnl;  // Alias pour compatibilité
+        metrics_dict["total_roll"] = strat.roll;
+        metrics_dict["total_roll_quarterly"] = strat.roll_quarterly;
+        metrics_dict["total_roll_sum"] = strat.roll_sum;
+        metrics_dict["sigma_pnl"] = strat.sigma_pnl;
+        metrics_dict["total_sigma_pnl"] = strat.sigma_pnl;  // Alias pour compatibilité
+        metrics_dict["max_profit"] = strat.max_profit;
+        metrics_dict["max_loss"] = strat.max_loss;
+        metrics_dict["max_loss_left"] = strat.max_loss_left;
+        metrics_dict["max_loss_right"] = strat.max_loss_right;
+        metrics_dict["min_profit_price"] = strat.min_profit_price;
+        metrics_dict["max_profit_price"] = strat.max_profit_price;
+        metrics_dict["profit_zone_width"] = strat.profit_zone_width;
+        metrics_dict["call_count"] = strat.call_count;
+        metrics_dict["put_count"] = strat.put_count;
+        metrics_dict["breakeven_points"] = strat.breakeven_points;
+        metrics_dict["score"] = strat.score;
+        metrics_dict["rank"] = strat.rank;
+        metrics_dict["pareto_front"] = strat.pareto_front;
+        metrics_dict["structure"] = StrategyScorer::group_label(static_cast<int>(strat.structure), GroupKey::STRUCTURE);
+        if (group_key.has_value()) {
+            metrics_dict["group"] = StrategyScorer::group_label(strat.group, group_key.value());
+        }
+        metrics_dict["delta_levrage"] = strat.delta_levrage;
+        metrics_dict["avg_pnl_levrage"] = strat.avg_pnl_levrage;
+        
+        // Ajouter le pnl_array
+        py::array_t<double> pnl_arr(strat.total_pnl_array.size());
+        auto pnl_out = pnl_arr.mutable_unchecked<1>();
+        for (size_t i = 0; i < strat.total_pnl_array.size(); ++i) {
+            pnl_out(i) = strat.total_pnl_array[i];
+        }
+        metrics_dict["pnl_array"] = pnl_arr;
+        
+        results.append(py::make_tuple(indices_list, signs_list, metrics_dict));
+    }
+    
+    return results;
+}
+
 /**
  * Initialise le cache avec toutes les données des options
  */
@@ -74,7 +706,14 @@ void init_options_cache(
     py::array_t<double> pnl_matrix,
     py::array_t<double> prices,
     py::array_t<double> mixture,
-    double average_mix
+    double average_mix,
+    std::optional<py::array_t<double>> open_interests = std::nullopt,
+    std::optional<py::array_t<double>> volumes = std::nullopt,
+    std::optional<py::array_t<double>> bid_sizes = std::nullopt,
+    std::optional<py::array_t<double>> ask_sizes = std::nullopt,
+    std::optional<py::array_t<double>> bids = std::nullopt,
+    std::optional<py::array_t<double>> asks = std::nullopt,
+    std::optional<py::array_t<int>> expiries = std::nullopt
 ) {
     auto prem_buf = premiums.unchecked<1>();
     auto delta_buf = deltas.unchecked<1>();
@@ -93,6 +732,10 @@ void init_options_cache(
     auto prices_buf = prices.unchecked<1>();
     auto mixture_buf = mixture.unchecked<1>();
     
+    // Le store de session référence les jambes et le P&L de l'ancien cache:
+    // rescore(), score_decomposition() et refilter() exigent un nouveau run
+    g_session.clear();
+    
     g_cache.n_options = prem_buf.shape(0);
     g_cache.pnl_length = prices_buf.shape(0);
     g_cache.average_mix = average_mix;
@@ -117,6 +760,13 @@ void init_options_cache(
         g_cache.options[i].roll = rolls_buf(i);
         g_cache.options[i].roll_quarterly = rolls_q_buf(i);
         g_cache.options[i].roll_sum = rolls_sum_buf(i);
+        g_cache.options[i].open_interest = 0.0;
+        g_cache.options[i].volume = 0.0;
+        g_cache.options[i].bid_size = 0.0;
+        g_cache.options[i].ask_size = 0.0;
+        g_cache.options[i].bid = 0.0;
+        g_cache.options[i].ask = 0.0;
+        g_cache.options[i].expiry = 0;
         
         g_cache.pnl_matrix[i].resize(g_cache.pnl_length);
         for (size_t j = 0; j < g_cache.pnl_length; ++j) {
@@ -124,6 +774,31 @@ void init_options_cache(
         }
     }
     
+    // Données de liquidité et cotations optionnelles (0 si absentes)
+    auto copy_optional = [](const std::optional<py::array_t<double>>& values, double OptionData::*field) {
+        if (!values.has_value()) {
+            return;
+        }
+        auto buf = values->unchecked<1>();
+        for (size_t i = 0; i < g_cache.n_options && i < static_cast<size_t>(buf.shape(0)); ++i) {
+            g_cache.options[i].*field = buf(i);
+        }
+    };
+    copy_optional(open_interests, &OptionData::open_interest);
+    copy_optional(volumes, &OptionData::volume);
+    copy_optional(bid_sizes, &OptionData::bid_size);
+    copy_optional(ask_sizes, &OptionData::ask_size);
+    copy_optional(bids, &OptionData::bid);
+    copy_optional(asks, &OptionData::ask);
+    
+    // Identifiants d'échéance optionnels (0: une seule échéance)
+    if (expiries.has_value()) {
+        auto buf = expiries->unchecked<1>();
+        for (size_t i = 0; i < g_cache.n_options && i < static_cast<size_t>(buf.shape(0)); ++i) {
+            g_cache.options[i].expiry = buf(i);
+        }
+    }
+    
     for (size_t i = 0; i < g_cache.pnl_length; ++i) {
         g_cache.prices[i] = prices_buf(i);
     }
@@ -134,245 +809,2181 @@ void init_options_cache(
         g_cache.mixture[i] = mixture_buf(i);
     }
     
+    build_contract_index(g_cache);
     g_cache.valid = true;
 }
 
 /**
- * Génère toutes les combinaisons inférieur à n_legs options, les score et retourne le top_n
+ * Masques de signes générés pour une combinaison: chaque jambe prend un signe
+ * autorisé (allowed_signs) et les jambes de même contrat partagent leur
+ * signe (sinon filter_same_option_buy_sell rejette).
+ * Masque = fixed | union des groupes libres choisis (bit i = jambe i long)
+ *
+ * @return false si aucun masque n'est possible
  */
-py::list process_combinations_batch_with_scoring(
-    int max_legs,
-    double max_loss_left,
-    double max_loss_right,
-    double max_premium_params,
-    int ouvert_gauche,
-    int ouvert_droite,
-    double min_premium_sell,
-    double delta_min,
-    double delta_max,
-    double limit_left,
-    double limit_right,
-    int top_n = 1000,
-    py::dict custom_weights = py::dict()
+static bool combo_sign_masks(
+    const std::vector<int>& indices,
+    const std::vector<uint8_t>& allowed,
+    int& fixed,
+    std::vector<int>& free_groups
 ) {
-    stop_flag.store(false);
+    const int n_legs = static_cast<int>(indices.size());
+    fixed = 0;
+    free_groups.clear();
+    int grouped = 0;
+    
+    for (int i = 0; i < n_legs; ++i) {
+        if (grouped & (1 << i)) {
+            continue;
+        }
+        const OptionData& leg = g_cache.options[indices[i]];
+        int group = 0;
+        uint8_t group_signs = SIGN_LONG | SIGN_SHORT;
+        for (int j = i; j < n_legs; ++j) {
+            const OptionData& other = g_cache.options[indices[j]];
+            if (same_contract(other, leg)) {
+                group |= 1 << j;
+                group_signs &= allowed[indices[j]];
+            }
+        }
+        grouped |= group;
+        
+        if (group_signs == 0) {
+            return false;
+        }
+        if (group_signs == (SIGN_LONG | SIGN_SHORT)) {
+            free_groups.push_back(group);
+        } else if (group_signs == SIGN_LONG) {
+            fixed |= group;
+        }
+    }
+    return true;
+}
 
-    if (!g_cache.valid || g_cache.n_options == 0) {
-        throw std::runtime_error("Cache non initialisé. Appelez init_options_cache() d'abord.");
+/**
+ * Motif de rejet d'un masque non généré, dans l'ordre des filtres de
+ * evaluate_combination puis calculate: liquidité, dominance, vente inutile,
+ * même option achetée et vendue
+ */
+static RejectInfo pruned_mask_reason(
+    const std::vector<int>& indices,
+    const std::vector<int>& combo_signs,
+    const std::vector<uint8_t>& permanent,
+    const FilterParams& filter
+) {
+    const size_t n_legs = indices.size();
+    for (size_t i = 0; i < n_legs; ++i) {
+        if (!StrategyCalculator::leg_liquid(g_cache.options[indices[i]], combo_signs[i], filter.liquidity)) {
+            return {RejectReason::LIQUIDITY, static_cast<double>(i)};
+        }
+    }
+    for (size_t i = 0; i < n_legs; ++i) {
+        const uint8_t sign_bit = combo_signs[i] > 0 ? SIGN_LONG : SIGN_SHORT;
+        if (!(permanent[indices[i]] & sign_bit)) {
+            return {RejectReason::DOMINATED, static_cast<double>(i)};
+        }
+    }
+    
+    double min_credit = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < n_legs; ++i) {
+        if (combo_signs[i] < 0) {
+            const OptionData& option = g_cache.options[indices[i]];
+            min_credit = std::min(min_credit,
+                option.premium - StrategyCalculator::leg_cost(option, -1, filter.execution));
+        }
+    }
+    if (min_credit < filter.min_premium_sell) {
+        return {RejectReason::USELESS_SELL, min_credit};
+    }
+    return {RejectReason::SAME_OPTION, 0.0};
+}
+
+/**
+ * Générateur DFS avec élagage par intervalles. Premium, delta et average_pnl
+ * sont des sommes signées par jambe: les r jambes restantes, prises aux
+ * positions >= p de l'univers, ajoutent entre r x min et r x max des
+ * contributions de ce suffixe. Un sous-arbre est coupé dès que
+ * |premium| <= max_premium, delta dans [delta_min, delta_max] ou
+ * average_pnl >= 0 devient inatteignable (tests de calculate, avec une
+ * marge d'arrondi: aucune stratégie valide n'est coupée).
+ *
+ * Même borne point par point sur la grille: le P&L final en g est au plus
+ * P&L partiel[g] + r x (meilleure contribution d'une jambe du suffixe en g).
+ * Si ce majorant est sous la perte admise de la zone de g (gauche, droite,
+ * ou -|premium| au centre), toutes les complétions sont rejetées.
+ */
+class IntervalDfs {
+public:
+    IntervalDfs(
+        const std::vector<int>& universe,
+        const std::vector<uint8_t>& allowed,
+        const FilterParams& filter
+    ) : universe_(universe), filter_(filter), grid_(g_cache.pnl_length) {
+        const size_t n = universe_.size();
+        choices_.resize(n);
+        suffix_min_.assign(n + 1, Sums{INF, INF, INF});
+        suffix_max_.assign(n + 1, Sums{-INF, -INF, -INF});
+        suffix_pnl_max_.assign((n + 1) * grid_, -INF);
+        
+        for (size_t p = n; p-- > 0;) {
+            const OptionData& option = g_cache.options[universe_[p]];
+            const std::vector<double>& pnl = g_cache.pnl_matrix[universe_[p]];
+            suffix_min_[p] = suffix_min_[p + 1];
+            suffix_max_[p] = suffix_max_[p + 1];
+            double* pnl_max = &suffix_pnl_max_[p * grid_];
+            std::copy_n(&suffix_pnl_max_[(p + 1) * grid_], grid_, pnl_max);
+            
+            for (int sign : {1, -1}) {
+                if (!(allowed[universe_[p]] & (sign > 0 ? SIGN_LONG : SIGN_SHORT))) {
+                    continue;
+                }
+                // Contribution au prix exécutable (voir apply_execution)
+                const double cost = StrategyCalculator::leg_cost(option, sign, filter.execution);
+                const Sums leg{
+                    sign * (option.premium + sign * cost),
+                    sign * option.delta,
+                    sign * (option.average_pnl - sign * cost)
+                };
+                choices_[p].push_back({sign, cost, leg});
+                suffix_min_[p].premium = std::min(suffix_min_[p].premium, leg.premium);
+                suffix_min_[p].delta = std::min(suffix_min_[p].delta, leg.delta);
+                suffix_min_[p].average_pnl = std::min(suffix_min_[p].average_pnl, leg.average_pnl);
+                suffix_max_[p].premium = std::max(suffix_max_[p].premium, leg.premium);
+                suffix_max_[p].delta = std::max(suffix_max_[p].delta, leg.delta);
+                suffix_max_[p].average_pnl = std::max(suffix_max_[p].average_pnl, leg.average_pnl);
+                for (size_t g = 0; g < grid_; ++g) {
+                    pnl_max[g] = std::max(pnl_max[g], sign * pnl[g] - cost);
+                }
+            }
+        }
+        
+        // Zone de chaque point de grille (même découpage que calculate)
+        zones_.resize(grid_);
+        for (size_t g = 0; g < grid_; ++g) {
+            const double price = g_cache.prices[g];
+            zones_[g] = price < filter.limit_left ? Zone::LEFT
+                      : price > filter.limit_right ? Zone::RIGHT
+                      : Zone::CENTER;
+        }
+    }
+    
+    /**
+     * Visite les feuilles de indices.size() jambes dont la première est à la
+     * position first (positions croissantes, jambes de même contrat de même
+     * signe)
+     *
+     * @param visit visit(indices, signes) pour chaque feuille atteignable
+     * @return Nombre de sous-arbres coupés
+     */
+    template <typename Visit>
+    size_t run(int first, std::vector<int>& indices, std::vector<int>& signs, Visit&& visit) const {
+        // P&L partiel de chaque profondeur
+        std::vector<double> partial_pnl(indices.size() * grid_);
+        size_t pruned = 0;
+        descend(0, first, Sums{}, indices, signs, partial_pnl, pruned, visit);
+        return pruned;
+    }
+
+private:
+    static constexpr double INF = std::numeric_limits<double>::infinity();
+    
+    enum class Zone : uint8_t { LEFT, CENTER, RIGHT };
+    
+    struct Sums {
+        double premium = 0.0;
+        double delta = 0.0;
+        double average_pnl = 0.0;
+    };
+    
+    struct Choice {
+        int sign;
+        double cost;
+        Sums leg;
+    };
+    
+    static double slack(double threshold) {
+        return DFS_BOUND_SLACK * std::max(1.0, std::abs(threshold));
+    }
+    
+    /**
+     * Les filtres linéaires peuvent-ils encore passer avec remaining jambes
+     * aux positions >= pos ?
+     * @param max_abs_premium Reçoit la borne de |premium| des complétions valides
+     */
+    bool reachable(const Sums& sums, int remaining, int pos, double& max_abs_premium) const {
+        Sums lo = sums;
+        Sums hi = sums;
+        if (remaining > 0) {
+            lo.premium += remaining * suffix_min_[pos].premium;
+            lo.delta += remaining * suffix_min_[pos].delta;
+            hi.premium += remaining * suffix_max_[pos].premium;
+            hi.delta += remaining * suffix_max_[pos].delta;
+            hi.average_pnl += remaining * suffix_max_[pos].average_pnl;
+        }
+        const double max_premium = filter_.max_premium_params;
+        max_abs_premium = std::min(max_premium, std::max(std::abs(lo.premium), std::abs(hi.premium)));
+        return lo.premium <= max_premium + slack(max_premium) &&
+               hi.premium >= -max_premium - slack(max_premium) &&
+               lo.delta <= filter_.delta_max + slack(filter_.delta_max) &&
+               hi.delta >= filter_.delta_min - slack(filter_.delta_min) &&
+               hi.average_pnl >= -slack(0.0);
+    }
+    
+    // Les filtres de perte par zone peuvent-ils encore passer ?
+    bool grid_reachable(const double* pnl, int remaining, int pos, double max_abs_premium) const {
+        const double* best = &suffix_pnl_max_[pos * grid_];
+        const double left_floor = -filter_.max_loss_left - slack(filter_.max_loss_left);
+        const double right_floor = -filter_.max_loss_right - slack(filter_.max_loss_right);
+        const double center_floor = -max_abs_premium - slack(max_abs_premium);
+        
+        for (size_t g = 0; g < grid_; ++g) {
+            const double upper = remaining > 0 ? pnl[g] + remaining * best[g] : pnl[g];
+            const double floor = zones_[g] == Zone::LEFT ? left_floor
+                               : zones_[g] == Zone::RIGHT ? right_floor
+                               : center_floor;
+            if (upper < floor) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    template <typename Visit>
+    void descend(
+        int depth,
+        int pos,
+        const Sums& sums,
+        std::vector<int>& indices,
+        std::vector<int>& signs,
+        std::vector<double>& partial_pnl,
+        size_t& pruned,
+        Visit& visit
+    ) const {
+        const int n_legs = static_cast<int>(indices.size());
+        const int remaining = n_legs - depth - 1;
+        const int index = universe_[pos];
+        const OptionData& option = g_cache.options[index];
+        const std::vector<double>& option_pnl = g_cache.pnl_matrix[index];
+        const double* previous = depth > 0 ? &partial_pnl[(depth - 1) * grid_] : nullptr;
+        double* current = &partial_pnl[depth * grid_];
+        
+        for (const Choice& choice : choices_[pos]) {
+            // Même contrat qu'une jambe précédente: même signe (filter_same_option_buy_sell)
+            bool consistent = true;
+            for (int j = 0; j < depth && consistent; ++j) {
+                consistent = !(same_contract(g_cache.options[indices[j]], option) && signs[j] != choice.sign);
+            }
+            if (!consistent) {
+                continue;
+            }
+            
+            const Sums next{
+                sums.premium + choice.leg.premium,
+                sums.delta + choice.leg.delta,
+                sums.average_pnl + choice.leg.average_pnl
+            };
+            double max_abs_premium = 0.0;
+            if (!reachable(next, remaining, pos, max_abs_premium)) {
+                ++pruned;
+                continue;
+            }
+            
+            for (size_t g = 0; g < grid_; ++g) {
+                current[g] = (previous ? previous[g] : 0.0) + choice.sign * option_pnl[g] - choice.cost;
+            }
+            if (!grid_reachable(current, remaining, pos, max_abs_premium)) {
+                ++pruned;
+                continue;
+            }
+            
+            indices[depth] = index;
+            signs[depth] = choice.sign;
+            if (remaining == 0) {
+                visit(indices, signs);
+                continue;
+            }
+            if (stop_flag.load()) {
+                return;
+            }
+            for (int p = pos; p < static_cast<int>(universe_.size()); ++p) {
+                descend(depth + 1, p, next, indices, signs, partial_pnl, pruned, visit);
+            }
+        }
+    }
+    
+    const std::vector<int>& universe_;
+    const FilterParams& filter_;
+    const size_t grid_;
+    std::vector<std::vector<Choice>> choices_;  // Signes autorisés et contributions, par position
+    std::vector<Sums> suffix_min_;              // Contribution min d'une jambe aux positions >= p
+    std::vector<Sums> suffix_max_;
+    std::vector<double> suffix_pnl_max_;        // (n + 1) x grille: meilleur P&L d'une jambe >= p en g
+    std::vector<Zone> zones_;
+};
+
+/**
+ * Générateur meet-in-the-middle. Une stratégie de n_legs jambes (positions
+ * croissantes dans l'univers) est la jonction d'une moitié gauche de
+ * n_legs / 2 jambes et d'une moitié droite du reste, la droite commençant à
+ * une position >= la dernière de la gauche. Les moitiés droites sont
+ * regroupées par première position et triées par premium: pour une moitié
+ * gauche, chaque groupe compatible est réduit par recherche dichotomique à
+ * la fenêtre |premium| <= max_premium, puis delta et average_pnl sont testés
+ * avant toute évaluation. Seules les paires dans les fenêtres passent au
+ * kernel (grille complète).
+ */
+class MeetInTheMiddle {
+public:
+    MeetInTheMiddle(
+        const std::vector<int>& universe,
+        const std::vector<uint8_t>& allowed,
+        const FilterParams& filter,
+        int n_legs
+    ) : universe_(universe), filter_(filter),
+        left_(build_halves(allowed, n_legs / 2)),
+        right_(build_halves(allowed, n_legs - n_legs / 2)) {
+        // Moitiés droites par (première position, premium)
+        std::vector<size_t> order(right_.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            const int first_a = right_.positions[a * right_.length];
+            const int first_b = right_.positions[b * right_.length];
+            return first_a != first_b ? first_a < first_b : right_.premium[a] < right_.premium[b];
+        });
+        right_ = right_.permuted(order);
+        
+        const size_t n = universe_.size();
+        bucket_start_.assign(n + 1, right_.size());
+        for (size_t h = right_.size(); h-- > 0;) {
+            bucket_start_[right_.positions[h * right_.length]] = h;
+        }
+        for (size_t p = n; p-- > 0;) {
+            bucket_start_[p] = std::min(bucket_start_[p], bucket_start_[p + 1]);
+        }
+    }
+    
+    size_t n_left() const { return left_.size(); }
+    size_t n_right() const { return right_.size(); }
+    
+    /**
+     * Joint la moitié gauche left à toutes les moitiés droites compatibles
+     *
+     * @param visit visit(indices, signes) pour chaque paire dans les fenêtres
+     * @return Nombre de paires visitées
+     */
+    template <typename Visit>
+    size_t join(size_t left, std::vector<int>& indices, std::vector<int>& signs, Visit&& visit) const {
+        const int left_length = left_.length;
+        const int right_length = right_.length;
+        const int last = left_length > 0 ? left_.positions[(left + 1) * left_length - 1] : 0;
+        for (int i = 0; i < left_length; ++i) {
+            indices[i] = universe_[left_.positions[left * left_length + i]];
+            signs[i] = left_.signs[left * left_length + i];
+        }
+        
+        const double max_premium = filter_.max_premium_params + slack(filter_.max_premium_params);
+        const double premium_lo = -max_premium - left_.premium[left];
+        const double premium_hi = max_premium - left_.premium[left];
+        const double delta_lo = filter_.delta_min - slack(filter_.delta_min) - left_.delta[left];
+        const double delta_hi = filter_.delta_max + slack(filter_.delta_max) - left_.delta[left];
+        const double average_lo = -slack(0.0) - left_.average_pnl[left];
+        
+        size_t visited = 0;
+        const auto premium_begin = right_.premium.begin();
+        for (size_t p = static_cast<size_t>(last); p < universe_.size(); ++p) {
+            const auto bucket_begin = premium_begin + bucket_start_[p];
+            const auto bucket_end = premium_begin + bucket_start_[p + 1];
+            const auto lo = std::lower_bound(bucket_begin, bucket_end, premium_lo);
+            const auto hi = std::upper_bound(lo, bucket_end, premium_hi);
+            
+            for (auto it = lo; it != hi; ++it) {
+                const size_t h = static_cast<size_t>(it - premium_begin);
+                if (right_.delta[h] < delta_lo || right_.delta[h] > delta_hi ||
+                    right_.average_pnl[h] < average_lo) {
+                    continue;
+                }
+                for (int j = 0; j < right_length; ++j) {
+                    indices[left_length + j] = universe_[right_.positions[h * right_length + j]];
+                    signs[left_length + j] = right_.signs[h * right_length + j];
+                }
+                if (!signs_consistent(indices, signs, left_length)) {
+                    continue;
+                }
+                ++visited;
+                visit(indices, signs);
+            }
+        }
+        return visited;
+    }
+
+private:
+    // Moitiés signées (struct of arrays), positions croissantes dans l'univers
+    struct HalfSet {
+        int length = 0;
+        std::vector<int> positions;   // size() x length
+        std::vector<int> signs;       // size() x length
+        std::vector<double> premium;
+        std::vector<double> delta;
+        std::vector<double> average_pnl;
+        
+        size_t size() const { return premium.size(); }
+        
+        HalfSet permuted(const std::vector<size_t>& order) const {
+            HalfSet out;
+            out.length = length;
+            for (size_t h : order) {
+                out.positions.insert(out.positions.end(),
+                    positions.begin() + h * length, positions.begin() + (h + 1) * length);
+                out.signs.insert(out.signs.end(),
+                    signs.begin() + h * length, signs.begin() + (h + 1) * length);
+                out.premium.push_back(premium[h]);
+                out.delta.push_back(delta[h]);
+                out.average_pnl.push_back(average_pnl[h]);
+            }
+            return out;
+        }
+    };
+    
+    static double slack(double threshold) {
+        return DFS_BOUND_SLACK * std::max(1.0, std::abs(threshold));
+    }
+    
+    /**
+     * Toutes les moitiés de length jambes: combinaisons de positions, puis
+     * masques de signes de combo_sign_masks. Sommes au prix exécutable.
+     * length = 0: une moitié vide
+     */
+    HalfSet build_halves(const std::vector<uint8_t>& allowed, int length) const {
+        HalfSet halves;
+        halves.length = length;
+        const int n = static_cast<int>(universe_.size());
+        if (length == 0) {
+            halves.premium.push_back(0.0);
+            halves.delta.push_back(0.0);
+            halves.average_pnl.push_back(0.0);
+            return halves;
+        }
+        if (n == 0) {
+            return halves;
+        }
+        
+        std::vector<int> c(length, 0);
+        std::vector<int> combo(length);
+        std::vector<int> free_groups;
+        do {
+            for (int i = 0; i < length; ++i) {
+                combo[i] = universe_[c[i]];
+            }
+            int fixed = 0;
+            if (!combo_sign_masks(combo, allowed, fixed, free_groups)) {
+                continue;
+            }
+            for (int k = 0; k < (1 << free_groups.size()); ++k) {
+                int mask = fixed;
+                for (size_t g = 0; g < free_groups.size(); ++g) {
+                    if (k & (1 << g)) {
+                        mask |= free_groups[g];
+                    }
+                }
+                double premium = 0.0, delta = 0.0, average_pnl = 0.0;
+                for (int i = 0; i < length; ++i) {
+                    const int sign = (mask & (1 << i)) ? 1 : -1;
+                    const OptionData& option = g_cache.options[combo[i]];
+                    const double cost = StrategyCalculator::leg_cost(option, sign, filter_.execution);
+                    premium += sign * (option.premium + sign * cost);
+                    delta += sign * option.delta;
+                    average_pnl += sign * (option.average_pnl - sign * cost);
+                    halves.positions.push_back(c[i]);
+                    halves.signs.push_back(sign);
+                }
+                halves.premium.push_back(premium);
+                halves.delta.push_back(delta);
+                halves.average_pnl.push_back(average_pnl);
+            }
+        } while (StrategyCalculator::next_combination(c, n));
+        return halves;
+    }
+    
+    // Jambes de même contrat de part et d'autre de la jonction: même signe
+    static bool signs_consistent(const std::vector<int>& indices, const std::vector<int>& signs, int split) {
+        const int n_legs = static_cast<int>(indices.size());
+        for (int i = 0; i < split; ++i) {
+            const OptionData& a = g_cache.options[indices[i]];
+            for (int j = split; j < n_legs; ++j) {
+                const OptionData& b = g_cache.options[indices[j]];
+                if (same_contract(a, b) && signs[i] != signs[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    const std::vector<int>& universe_;
+    const FilterParams& filter_;
+    HalfSet left_;
+    HalfSet right_;
+    std::vector<size_t> bucket_start_;  // Moitiés droites de première position p: [start[p], start[p + 1])
+};
+
+/**
+ * Générateur par cliques du graphe de compatibilité des jambes. Un nœud est
+ * une jambe (position dans l'univers, signe autorisé), numérotée
+ * position * 2 + (vente ? 1 : 0). Deux nœuds sont reliés sauf si aucune
+ * combinaison de n_legs jambes qui les contient ne peut passer pour une
+ * raison propre à la paire:
+ *  - même contrat (type, strike, échéance), signes opposés (g_cache.same_contract);
+ *  - premium, delta ou average_pnl de la paire hors fenêtre, même avec les
+ *    n_legs - 2 autres jambes les plus favorables de l'univers.
+ * Un nœud relié à lui-même peut être répété (même option, même signe).
+ * Les combinaisons sont les cliques à nœuds croissants, répétitions permises:
+ * candidats(d + 1) = candidats(d) & voisins(v) & {nœuds >= v}, mot par mot.
+ */
+class CliqueGenerator {
+public:
+    CliqueGenerator(
+        const std::vector<int>& universe,
+        const std::vector<uint8_t>& allowed,
+        const FilterParams& filter,
+        int n_legs
+    ) : filter_(filter), n_legs_(n_legs), n_nodes_(universe.size() * 2),
+        words_((n_nodes_ + 63) / 64) {
+        node_index_.resize(n_nodes_);
+        node_sign_.resize(n_nodes_);
+        std::vector<Sums> legs(n_nodes_);
+        std::vector<char> usable(n_nodes_, 0);
+        Sums lo{INF, INF, INF};
+        Sums hi{-INF, -INF, -INF};
+        
+        for (size_t v = 0; v < n_nodes_; ++v) {
+            const int index = universe[v / 2];
+            const int sign = (v % 2 == 0) ? 1 : -1;
+            node_index_[v] = index;
+            node_sign_[v] = sign;
+            if (!(allowed[index] & (sign > 0 ? SIGN_LONG : SIGN_SHORT))) {
+                continue;
+            }
+            // Contribution au prix exécutable (voir apply_execution)
+            const OptionData& option = g_cache.options[index];
+            const double cost = StrategyCalculator::leg_cost(option, sign, filter.execution);
+            legs[v] = {
+                sign * (option.premium + sign * cost),
+                sign * option.delta,
+                sign * (option.average_pnl - sign * cost)
+            };
+            usable[v] = 1;
+            lo = {std::min(lo.premium, legs[v].premium), std::min(lo.delta, legs[v].delta),
+                  std::min(lo.average_pnl, legs[v].average_pnl)};
+            hi = {std::max(hi.premium, legs[v].premium), std::max(hi.delta, legs[v].delta),
+                  std::max(hi.average_pnl, legs[v].average_pnl)};
+        }
+        
+        // Nœuds actifs: atteignables avec n_legs - 1 autres jambes
+        active_.assign(words_, 0);
+        for (size_t v = 0; v < n_nodes_; ++v) {
+            if (usable[v] && window_reachable(legs[v], n_legs_ - 1, lo, hi)) {
+                active_[v / 64] |= uint64_t{1} << (v % 64);
+            }
+        }
+        
+        // Arêtes (u, v), u <= v: paires atteignables avec n_legs - 2 autres jambes
+        adjacency_.assign(n_nodes_ * words_, 0);
+        if (n_legs_ < 2) {
+            return;
+        }
+        for (size_t u = 0; u < n_nodes_; ++u) {
+            if (!bit(active_.data(), u)) {
+                continue;
+            }
+            const size_t option_u = static_cast<size_t>(node_index_[u]);
+            for (size_t v = u; v < n_nodes_; ++v) {
+                if (!bit(active_.data(), v)) {
+                    continue;
+                }
+                const size_t option_v = static_cast<size_t>(node_index_[v]);
+                if (node_sign_[u] != node_sign_[v] &&
+                    bit(&g_cache.same_contract[option_u * g_cache.contract_words], option_v)) {
+                    continue;
+                }
+                const Sums pair{
+                    legs[u].premium + legs[v].premium,
+                    legs[u].delta + legs[v].delta,
+                    legs[u].average_pnl + legs[v].average_pnl
+                };
+                if (window_reachable(pair, n_legs_ - 2, lo, hi)) {
+                    adjacency_[u * words_ + v / 64] |= uint64_t{1} << (v % 64);
+                    adjacency_[v * words_ + u / 64] |= uint64_t{1} << (u % 64);
+                }
+            }
+        }
+    }
+    
+    size_t n_nodes() const { return n_nodes_; }
+    
+    // Nombre d'arêtes (u <= v) du graphe, pour la densité
+    size_t n_edges() const {
+        size_t degrees = 0;
+        size_t loops = 0;
+        for (size_t v = 0; v < n_nodes_; ++v) {
+            for (size_t w = 0; w < words_; ++w) {
+                degrees += popcount64(adjacency_[v * words_ + w]);
+            }
+            loops += bit(&adjacency_[v * words_], v) ? 1 : 0;
+        }
+        return (degrees + loops) / 2;
+    }
+    
+    /**
+     * Visite les cliques de n_legs nœuds croissants dont le premier est first
+     * @param visit visit(indices, signes) pour chaque clique
+     */
+    template <typename Visit>
+    void run(size_t first, std::vector<int>& indices, std::vector<int>& signs, Visit&& visit) const {
+        if (!bit(active_.data(), first)) {
+            return;
+        }
+        std::vector<uint64_t> candidates(static_cast<size_t>(n_legs_) * words_);
+        descend(0, first, active_.data(), indices, signs, candidates, visit);
+    }
+
+private:
+    static constexpr double INF = std::numeric_limits<double>::infinity();
+    
+    struct Sums {
+        double premium = 0.0;
+        double delta = 0.0;
+        double average_pnl = 0.0;
+    };
+    
+    static bool bit(const uint64_t* row, size_t v) {
+        return (row[v / 64] >> (v % 64)) & 1;
+    }
+    
+    static double slack(double threshold) {
+        return DFS_BOUND_SLACK * std::max(1.0, std::abs(threshold));
+    }
+    
+    // Les fenêtres de calculate sont-elles atteignables avec others jambes dans [lo, hi] ?
+    bool window_reachable(const Sums& sums, int others, const Sums& lo, const Sums& hi) const {
+        const double r = static_cast<double>(others);
+        const double premium_lo = others > 0 ? sums.premium + r * lo.premium : sums.premium;
+        const double premium_hi = others > 0 ? sums.premium + r * hi.premium : sums.premium;
+        const double delta_lo = others > 0 ? sums.delta + r * lo.delta : sums.delta;
+        const double delta_hi = others > 0 ? sums.delta + r * hi.delta : sums.delta;
+        const double average_hi = others > 0 ? sums.average_pnl + r * hi.average_pnl : sums.average_pnl;
+        const double max_premium = filter_.max_premium_params;
+        return premium_lo <= max_premium + slack(max_premium) &&
+               premium_hi >= -max_premium - slack(max_premium) &&
+               delta_lo <= filter_.delta_max + slack(filter_.delta_max) &&
+               delta_hi >= filter_.delta_min - slack(filter_.delta_min) &&
+               average_hi >= -slack(0.0);
+    }
+    
+    template <typename Visit>
+    void descend(
+        int depth,
+        size_t node,
+        const uint64_t* previous,
+        std::vector<int>& indices,
+        std::vector<int>& signs,
+        std::vector<uint64_t>& candidates,
+        Visit& visit
+    ) const {
+        indices[depth] = node_index_[node];
+        signs[depth] = node_sign_[node];
+        if (depth + 1 == n_legs_) {
+            visit(indices, signs);
+            return;
+        }
+        if (stop_flag.load()) {
+            return;
+        }
+        
+        // Candidats: compatibles avec toutes les jambes choisies, nœuds >= node
+        uint64_t* current = &candidates[depth * words_];
+        const uint64_t* neighbours = &adjacency_[node * words_];
+        const size_t first_word = node / 64;
+        std::fill(current, current + first_word, 0);
+        for (size_t w = first_word; w < words_; ++w) {
+            current[w] = previous[w] & neighbours[w];
+        }
+        current[first_word] &= ~uint64_t{0} << (node % 64);
+        
+        for (size_t w = first_word; w < words_; ++w) {
+            uint64_t bits = current[w];
+            while (bits != 0) {
+                const size_t next = w * 64 + count_trailing_zeros64(bits);
+                bits &= bits - 1;
+                descend(depth + 1, next, current, indices, signs, candidates, visit);
+            }
+        }
+    }
+    
+    const FilterParams& filter_;
+    const int n_legs_;
+    const size_t n_nodes_;
+    const size_t words_;
+    std::vector<int> node_index_;       // Index du cache de chaque nœud
+    std::vector<int> node_sign_;
+    std::vector<uint64_t> active_;      // Nœuds utilisables (bitset)
+    std::vector<uint64_t> adjacency_;   // n_nodes x words: voisins de chaque nœud
+};
+
+/**
+ * Score de recherche d'une stratégie rejetée: toujours sous les valides
+ * (score dans [0, 1]), d'autant plus bas que le filtre en échec est tôt
+ * dans calculate
+ */
+static double rejected_search_score(RejectReason reason) {
+    const double stage = std::min(static_cast<double>(reason), static_cast<double>(RejectReason::RULE));
+    return -2.0 + stage / static_cast<double>(RejectReason::RULE);
+}
+
+/**
+ * Jambes toutes autorisées (allowed_signs), même signe pour un même contrat
+ * (filter_same_option_buy_sell) et pas plus d'échéances que la politique n'en
+ * admet (ajouter une jambe n'en retire jamais)
+ */
+static bool legs_allowed(
+    const std::vector<int>& indices,
+    const std::vector<int>& signs,
+    const std::vector<uint8_t>& allowed,
+    const ExpiryPolicy& expiry
+) {
+    const size_t n_legs = indices.size();
+    if (expiry.active() && StrategyCalculator::expiry_count(g_cache.options, indices) > expiry.max_count()) {
+        return false;
+    }
+    for (size_t i = 0; i < n_legs; ++i) {
+        if (!(allowed[indices[i]] & (signs[i] > 0 ? SIGN_LONG : SIGN_SHORT))) {
+            return false;
+        }
+        const OptionData& a = g_cache.options[indices[i]];
+        for (size_t j = 0; j < i; ++j) {
+            const OptionData& b = g_cache.options[indices[j]];
+            if (same_contract(a, b) && signs[i] != signs[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Clé d'une stratégie (index * 2 + long), jambes dans l'ordre canonique
+static std::vector<int> legs_key(const std::vector<int>& indices, const std::vector<int>& signs) {
+    std::vector<int> key(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        key[i] = indices[i] * 2 + (signs[i] > 0 ? 1 : 0);
+    }
+    return key;
+}
+
+/**
+ * Recherche heuristique anytime (generator="beam"), pour les univers et
+ * nombres de jambes hors de portée de l'énumération.
+ *
+ * Beam search sur l'ajout de jambes: à chaque profondeur, chaque état
+ * (positions croissantes, signes autorisés) est étendu d'une jambe, les
+ * enfants sont évalués en parallèle par evaluate_combination et les
+ * beam_width meilleurs sont gardés. Les valides sont scorés par l'objectif
+ * figé sur les bornes de toutes les valides trouvées (freeze_ranges), les
+ * rejetés par rejected_search_score.
+ *
+ * Puis anneal_chains chaînes de recuit simulé partent des meilleures
+ * stratégies (signe inversé, strike voisin, jambe ajoutée ou retirée), une
+ * graine par chaîne: le résultat ne dépend pas du nombre de threads. Le
+ * strike voisin est le strike immédiatement inférieur ou supérieur de même
+ * type (call/put) et de même échéance.
+ *
+ * @return Toutes les stratégies valides rencontrées, sans doublon
+ */
+std::vector<ScoredStrategy> beam_search(
+    int max_legs,
+    const std::vector<int>& universe,
+    const std::vector<uint8_t>& allowed,
+    const FilterParams& filter,
+    const RuleProgram* rules,
+    const SearchParams& params
+) {
+    using Clock = std::chrono::steady_clock;
+    const bool timed = params.time_limit > 0.0;
+    const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(timed ? params.time_limit : 0.0));
+    auto expired = [&]() {
+        return stop_flag.load() || (timed && Clock::now() >= deadline);
+    };
+    
+    const int n = static_cast<int>(universe.size());
+    const size_t beam_width = static_cast<size_t>(std::max(params.beam_width, 1));
+    
+    std::vector<ScoredStrategy> pool;
+    std::set<std::vector<int>> seen;
+    std::vector<MetricConfig> frozen = StrategyScorer::freeze_ranges(pool, params.objective);
+    
+    // ========== BEAM SEARCH ==========
+    struct State {
+        std::vector<int> positions;
+        std::vector<int> signs;
+        double score = 0.0;
+    };
+    std::vector<State> beam(1);
+    
+    for (int depth = 1; depth <= max_legs && !beam.empty() && !expired(); ++depth) {
+        // Enfants: une jambe de plus, à une position >= la dernière (parent unique)
+        std::vector<State> children;
+        std::vector<int> indices;
+        for (const State& state : beam) {
+            const int start = state.positions.empty() ? 0 : state.positions.back();
+            for (int p = start; p < n; ++p) {
+                for (int sign : {1, -1}) {
+                    State child{state.positions, state.signs, 0.0};
+                    child.positions.push_back(p);
+                    child.signs.push_back(sign);
+                    indices.clear();
+                    for (int position : child.positions) {
+                        indices.push_back(universe[position]);
+                    }
+                    if (legs_allowed(indices, child.signs, allowed, filter.expiry)) {
+                        seen.insert(legs_key(indices, child.signs));
+                        children.push_back(std::move(child));
+                    }
+                }
+            }
+        }
+        
+        // Évaluation parallèle, un emplacement par enfant
+        const int64_t n_children = static_cast<int64_t>(children.size());
+        std::vector<std::optional<ScoredStrategy>> results(children.size());
+        std::vector<RejectReason> reasons(children.size(), RejectReason::NONE);
+        
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int64_t c = 0; c < n_children; ++c) {
+            if (stop_flag.load()) {
+                continue;
+            }
+            std::vector<int> child_indices;
+            for (int position : children[c].positions) {
+                child_indices.push_back(universe[position]);
+            }
+            RejectInfo reject;
+            results[c] = evaluate_combination(child_indices, children[c].signs, filter, &reject, rules);
+            reasons[c] = reject.reason;
+        }
+        
+        size_t depth_valid = 0;
+        for (const auto& result : results) {
+            if (result.has_value()) {
+                pool.push_back(result.value());
+                ++depth_valid;
+            }
+        }
+        frozen = StrategyScorer::freeze_ranges(pool, params.objective);
+        
+        for (size_t c = 0; c < children.size(); ++c) {
+            children[c].score = results[c].has_value()
+                ? StrategyScorer::score_fixed(results[c].value(), frozen)
+                : rejected_search_score(reasons[c]);
+        }
+        
+        // Les beam_width meilleurs (tri stable: ordre de génération déterministe)
+        std::stable_sort(children.begin(), children.end(),
+            [](const State& a, const State& b) { return a.score > b.score; });
+        if (children.size() > beam_width) {
+            children.resize(beam_width);
+        }
+        beam = std::move(children);
+        
+        std::cout << "beam n_legs=" << depth << " enfants=" << n_children
+                  << " valides=" << depth_valid << std::endl;
+    }
+    
+    // ========== RECUIT SIMULÉ ==========
+    const int n_chains = params.anneal_chains;
+    if (n_chains <= 0 || pool.empty() || expired()) {
+        return pool;
+    }
+    
+    // Départs: meilleures stratégies du pool pour l'objectif figé
+    std::vector<std::pair<double, size_t>> starts;
+    for (size_t i = 0; i < pool.size(); ++i) {
+        starts.push_back({StrategyScorer::score_fixed(pool[i], frozen), i});
+    }
+    std::stable_sort(starts.begin(), starts.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+    
+    std::vector<int> position_of(g_cache.n_options, -1);
+    for (int p = 0; p < n; ++p) {
+        position_of[universe[p]] = p;
+    }
+    
+    // Strikes voisins: même type et même échéance, strike immédiatement
+    // inférieur/supérieur (l'univers est dans l'ordre du cache, call et put
+    // alternés par strike, un décalage de position ne suffit pas)
+    std::vector<int> by_contract(n);
+    std::iota(by_contract.begin(), by_contract.end(), 0);
+    auto contract_key = [&](int p) {
+        const OptionData& option = g_cache.options[universe[p]];
+        return std::make_tuple(option.is_call, option.expiry, option.strike, p);
+    };
+    std::sort(by_contract.begin(), by_contract.end(),
+        [&](int a, int b) { return contract_key(a) < contract_key(b); });
+    
+    std::vector<int> prev_strike(n, -1);
+    std::vector<int> next_strike(n, -1);
+    size_t prev_begin = 0, prev_end = 0;
+    for (size_t begin = 0; begin < by_contract.size();) {
+        const OptionData& head = g_cache.options[universe[by_contract[begin]]];
+        size_t end = begin + 1;
+        while (end < by_contract.size() &&
+               g_cache.options[universe[by_contract[end]]].strike == head.strike &&
+               g_cache.options[universe[by_contract[end]]].is_call == head.is_call &&
+               g_cache.options[universe[by_contract[end]]].expiry == head.expiry) {
+            ++end;
+        }
+        const OptionData& previous = g_cache.options[universe[by_contract[prev_begin]]];
+        if (prev_end > prev_begin &&
+            previous.is_call == head.is_call && previous.expiry == head.expiry) {
+            for (size_t k = begin; k < end; ++k) {
+                prev_strike[by_contract[k]] = by_contract[prev_begin];
+            }
+            for (size_t k = prev_begin; k < prev_end; ++k) {
+                next_strike[by_contract[k]] = by_contract[begin];
+            }
+        }
+        prev_begin = begin;
+        prev_end = end;
+        begin = end;
+    }
+    
+    std::vector<std::vector<ScoredStrategy>> chain_found(n_chains);
+    
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int chain = 0; chain < n_chains; ++chain) {
+        std::mt19937_64 rng(params.seed + static_cast<uint64_t>(chain));
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        
+        const ScoredStrategy& start = pool[starts[chain % starts.size()].second];
+        std::vector<int> positions;
+        for (int index : start.option_indices) {
+            positions.push_back(position_of[index]);
+        }
+        std::vector<int> signs = start.signs;
+        double current = starts[chain % starts.size()].first;
+        
+        std::set<std::vector<int>> chain_seen;
+        std::vector<std::pair<int, int>> legs;
+        std::vector<int> indices;
+        std::vector<int> proposal_signs;
+        for (int step = 0; step < params.anneal_steps; ++step) {
+            if ((step & 63) == 0 && expired()) {
+                break;
+            }
+            
+            // Mouvement: inverser un signe, strike voisin, ajouter ou retirer une jambe
+            legs.clear();
+            for (size_t i = 0; i < positions.size(); ++i) {
+                legs.push_back({positions[i], signs[i]});
+            }
+            const int leg = static_cast<int>(unit(rng) * legs.size());
+            const int move = static_cast<int>(unit(rng) * 4);
+            if (move == 0) {
+                legs[leg].second = -legs[leg].second;
+            } else if (move == 1) {
+                const int neighbour = unit(rng) < 0.5
+                    ? prev_strike[legs[leg].first] : next_strike[legs[leg].first];
+                if (neighbour < 0) {
+                    continue;
+                }
+                legs[leg].first = neighbour;
+            } else if (move == 2 && static_cast<int>(legs.size()) < max_legs) {
+                legs.push_back({static_cast<int>(unit(rng) * n), unit(rng) < 0.5 ? -1 : 1});
+            } else if (move == 3 && legs.size() > 1) {
+                legs.erase(legs.begin() + leg);
+            } else {
+                continue;
+            }
+            
+            // Ordre canonique: positions croissantes (comme l'énumération)
+            std::sort(legs.begin(), legs.end());
+            indices.clear();
+            proposal_signs.clear();
+            for (const auto& [position, sign] : legs) {
+                indices.push_back(universe[position]);
+                proposal_signs.push_back(sign);
+            }
+            if (!legs_allowed(indices, proposal_signs, allowed, filter.expiry)) {
+                continue;
+            }
+            
+            auto strat = evaluate_combination(indices, proposal_signs, filter, nullptr, rules);
+            if (!strat.has_value()) {
+                continue;
+            }
+            const double score = StrategyScorer::score_fixed(strat.value(), frozen);
+            if (chain_seen.insert(legs_key(indices, proposal_signs)).second) {
+                chain_found[chain].push_back(std::move(strat.value()));
+            }
+            
+            // Metropolis, température décroissante linéairement
+            const double temperature = params.temperature * (1.0 - static_cast<double>(step) / params.anneal_steps);
+            if (score >= current ||
+                (temperature > 0.0 && unit(rng) < std::exp((score - current) / temperature))) {
+                current = score;
+                positions.clear();
+                signs = proposal_signs;
+                for (const auto& entry : legs) {
+                    positions.push_back(entry.first);
+                }
+            }
+        }
+    }
+    
+    // Fusion dans l'ordre des chaînes, sans doublon
+    size_t annealed = 0;
+    for (auto& found : chain_found) {
+        for (auto& strat : found) {
+            if (seen.insert(legs_key(strat.option_indices, strat.signs)).second) {
+                pool.push_back(std::move(strat));
+                ++annealed;
+            }
+        }
+    }
+    std::cout << "recuit chaines=" << n_chains << " nouvelles=" << annealed << std::endl;
+    return pool;
+}
+
+/**
+ * Combinaisons d'une partition sous contraintes de structure (masks).
+ * Les options sont parcourues par strike croissant: après une jambe de
+ * strike k, la suivante est au même strike ou dans
+ * [k + min_spacing, k + max_spacing], deux plages trouvées par recherche
+ * dichotomique; le reste de la partition n'est jamais parcouru. Les nombres
+ * de calls et de puts coupent les branches qui ne peuvent plus les
+ * respecter; la symétrie des ailes est vérifiée sur la combinaison complète
+ * (legs_within).
+ */
+class StrikeOrderedCombinations {
+public:
+    StrikeOrderedCombinations(const std::vector<int>& part, const LegConstraints& legs)
+        : legs_(legs), order_(part) {
+        std::stable_sort(order_.begin(), order_.end(), [](int a, int b) {
+            return g_cache.options[a].strike < g_cache.options[b].strike;
+        });
+        for (int index : order_) {
+            strikes_.push_back(g_cache.options[index].strike);
+        }
+    }
+    
+    /**
+     * @param emit emit(indices) pour chaque combinaison conforme, indices
+     *        croissants (ordre canonique de l'énumération)
+     */
+    template <typename Emit>
+    void run(int n_legs, Emit&& emit) const {
+        std::vector<int> positions(n_legs);
+        std::vector<int> combo(n_legs);
+        descend(0, 0, 0, 0, positions, combo, emit);
+    }
+
+private:
+    static double tol(double strike) { return 1e-9 * std::max(1.0, std::abs(strike)); }
+    
+    template <typename Emit>
+    void descend(int depth, int start, int n_calls, int n_puts,
+                 std::vector<int>& positions, std::vector<int>& combo, Emit& emit) const {
+        const int n_legs = static_cast<int>(positions.size());
+        if (depth == n_legs) {
+            for (int i = 0; i < n_legs; ++i) {
+                combo[i] = order_[positions[i]];
+            }
+            std::sort(combo.begin(), combo.end());
+            if (StrategyCalculator::legs_within(g_cache.options, combo, legs_)) {
+                emit(combo);
+            }
+            return;
+        }
+        
+        // Plages de la jambe suivante: [start, same_end) au même strike, puis [next_begin, next_end)
+        const int n = static_cast<int>(order_.size());
+        int same_end = n;
+        int next_begin = n;
+        int next_end = n;
+        if (depth > 0) {
+            const double last = strikes_[positions[depth - 1]];
+            auto position = [this](double strike) {
+                return static_cast<int>(std::upper_bound(strikes_.begin(), strikes_.end(), strike) - strikes_.begin());
+            };
+            same_end = position(last + tol(last));
+            next_begin = std::max(same_end, position(last + legs_.min_spacing - 2 * tol(last)));
+            next_end = std::max(next_begin, position(last + legs_.max_spacing + 2 * tol(last)));
+        }
+        
+        const int remaining = n_legs - depth - 1;
+        auto visit = [&](int p) {
+            const bool call = g_cache.options[order_[p]].is_call;
+            const int calls = n_calls + (call ? 1 : 0);
+            const int puts = n_puts + (call ? 0 : 1);
+            if (calls > legs_.max_calls || puts > legs_.max_puts ||
+                std::max(0, legs_.min_calls - calls) + std::max(0, legs_.min_puts - puts) > remaining) {
+                return;
+            }
+            positions[depth] = p;
+            descend(depth + 1, p, calls, puts, positions, combo, emit);
+        };
+        for (int p = start; p < same_end; ++p) {
+            visit(p);
+        }
+        for (int p = next_begin; p < next_end; ++p) {
+            visit(p);
+        }
+    }
+    
+    const LegConstraints& legs_;
+    std::vector<int> order_;        // Indices du cache par strike croissant
+    std::vector<double> strikes_;
+};
+
+/**
+ * Partitions de l'univers énumérées séparément: une par échéance quand la
+ * politique n'en admet qu'une (les combinaisons croisées ne sont jamais
+ * générées), sinon l'univers entier. Positions croissantes dans chaque partition.
+ */
+static std::vector<std::vector<int>> expiry_partitions(
+    const std::vector<int>& universe,
+    const ExpiryPolicy& expiry
+) {
+    if (!expiry.partitioned()) {
+        return {universe};
+    }
+    std::map<int, std::vector<int>> by_expiry;
+    for (int index : universe) {
+        by_expiry[g_cache.options[index].expiry].push_back(index);
+    }
+    std::vector<std::vector<int>> partitions;
+    for (auto& entry : by_expiry) {
+        partitions.push_back(std::move(entry.second));
+    }
+    return partitions;
+}
+
+// Partition d'une tâche globale (offsets: début de chaque partition, puis le total)
+static size_t partition_of(const std::vector<size_t>& offsets, size_t task) {
+    return static_cast<size_t>(std::upper_bound(offsets.begin(), offsets.end(), task) - offsets.begin()) - 1;
+}
+
+/**
+ * Énumère toutes les combinaisons de 1 à max_legs options en parallèle et
+ * retourne les stratégies valides, non scorées. Seuls les masques de signes
+ * compatibles avec allowed_signs et filter_same_option_buy_sell sont évalués;
+ * les autres sont journalisés avec leur motif sans appel à calculate.
+ *
+ * @param rejections Optionnel: reçoit le journal des rejets par n_legs
+ * @param fixed_metrics Optionnel: métriques FIXED (poids normalisés). Chaque
+ *        stratégie est scorée à l'évaluation et seules les top_capacity
+ *        meilleures sont conservées (heaps bornés par thread), triées par score
+ * @param rules Optionnel: règles déclaratives évaluées dans le kernel
+ * @param generator DFS (IntervalDfs), MITM (MeetInTheMiddle) ou CLIQUE
+ *        (CliqueGenerator): seuls les candidats dans les bornes sont évalués.
+ *        BEAM (beam_search, paramètres search requis): stratégies valides
+ *        trouvées par la recherche. Incompatibles avec le journal des rejets
+ * @param rank_metrics Optionnel: les métriques PERCENTILE / ROBUST reçoivent
+ *        les quantiles de l'ensemble valide (MetricConfig::quantiles). Un
+ *        sketch par thread est alimenté à chaque stratégie retenue, puis les
+ *        sketches sont fusionnés dans l'ordre des threads: ni tri ni second
+ *        passage sur les colonnes
+ *
+ * La politique d'échéances (filter.expiry) partitionne l'univers
+ * (expiry_partitions); les autres combinaisons hors politique sont écartées
+ * à la génération, sans évaluation ni journal.
+ */
+std::vector<ScoredStrategy> enumerate_strategies(
+    int max_legs,
+    const FilterParams& filter,
+    std::vector<RejectionLog>* rejections = nullptr,
+    const std::vector<MetricConfig>* fixed_metrics = nullptr,
+    size_t top_capacity = 0,
+    const RuleProgram* rules = nullptr,
+    GeneratorMode generator = GeneratorMode::MASKS,
+    const SearchParams* search = nullptr,
+    std::vector<MetricConfig>* rank_metrics = nullptr
+) {
+    if (!g_cache.valid || g_cache.n_options == 0) {
+        throw std::runtime_error("Cache non initialisé. Appelez init_options_cache() d'abord.");
     }
     
     if (max_legs <= 0 || max_legs > static_cast<int>(g_cache.n_options)) {
         throw std::invalid_argument("n_legs invalide");
     }
     
-    std::vector<ScoredStrategy> valid_strategies;
-    valid_strategies.reserve(1000000); 
+    // Journal des rejets pour le refiltre incrémental
+    const bool log_rejections = rejections != nullptr;
+    const bool dfs = generator == GeneratorMode::DFS;
+    const bool mitm = generator == GeneratorMode::MITM;
+    const bool clique = generator == GeneratorMode::CLIQUE;
+    if (generator != GeneratorMode::MASKS && log_rejections) {
+        throw std::invalid_argument("generator dfs/mitm/clique/beam: incompatible avec le journal des rejets");
+    }
+    
+    // Signes autorisés par option. Avec journal, l'univers ne dépend pas de
+    // min_premium_sell (re-filtrable): les ventes inutiles sont retirées par masque
+    const std::vector<uint8_t> allowed = StrategyCalculator::allowed_signs(g_cache.options, filter, true);
+    const std::vector<uint8_t> permanent = log_rejections
+        ? StrategyCalculator::allowed_signs(g_cache.options, filter, false)
+        : allowed;
+    
+    // Univers d'énumération: options utilisables comme jambe pour au moins un signe,
+    // dans la fenêtre de strikes des contraintes de structure
+    std::vector<int> universe;
+    for (size_t i = 0; i < g_cache.n_options; ++i) {
+        if (permanent[i] != 0 &&
+            (!filter.legs.active() || StrategyCalculator::strike_in_window(g_cache.options[i], filter.legs))) {
+            universe.push_back(static_cast<int>(i));
+        }
+    }
+    const int universe_size = static_cast<int>(universe.size());
+    if (universe_size < static_cast<int>(g_cache.n_options)) {
+        std::cout << "Univers: " << (g_cache.n_options - universe.size()) << " options retirées, "
+                  << universe_size << " restantes" << std::endl;
+    }
+    
+    std::vector<ScoredStrategy> valid_strategies;
+    valid_strategies.reserve(1000000); 
+    
+    // Scoring en un passage: aucun stockage des candidats
+    const bool streaming = fixed_metrics != nullptr;
+    TopStrategyHeap top_heap(top_capacity);
+    
+    // Quantiles des normaliseurs PERCENTILE / ROBUST: un sketch par thread et par métrique
+    std::vector<size_t> rank_columns;
+    if (rank_metrics != nullptr) {
+        for (size_t j = 0; j < rank_metrics->size(); ++j) {
+            if (StrategyScorer::is_rank_normalizer((*rank_metrics)[j].normalizer)) {
+                rank_columns.push_back(j);
+            }
+        }
+    }
+    std::vector<std::vector<QuantileSketch>> thread_sketches(
+        rank_columns.empty() ? 0 : static_cast<size_t>(omp_get_max_threads()),
+        std::vector<QuantileSketch>(rank_columns.size()));
+    auto sketch_strategy = [&](std::vector<QuantileSketch>& sketches, const ScoredStrategy& strat) {
+        for (size_t r = 0; r < rank_columns.size(); ++r) {
+            sketches[r].insert(StrategyScorer::metric_value(strat, (*rank_metrics)[rank_columns[r]]));
+        }
+    };
+    auto publish_quantiles = [&]() {
+        for (size_t r = 0; r < rank_columns.size(); ++r) {
+            auto merged = std::make_shared<QuantileSketch>();
+            for (const auto& sketches : thread_sketches) {
+                merged->merge(sketches[r]);
+            }
+            merged->prepare();
+            (*rank_metrics)[rank_columns[r]].quantiles = std::move(merged);
+        }
+    };
+    
+    // Recherche heuristique: pas d'énumération par niveau
+    if (generator == GeneratorMode::BEAM) {
+        std::vector<ScoredStrategy> found = beam_search(max_legs, universe, allowed, filter, rules, *search);
+        if (stop_flag.load()) {
+            throw std::runtime_error("Cancelled by user");
+        }
+        if (!rank_columns.empty()) {
+            for (const auto& strat : found) {
+                sketch_strategy(thread_sketches[0], strat);
+            }
+            publish_quantiles();
+        }
+        if (!streaming) {
+            return found;
+        }
+        for (auto& strat : found) {
+            strat.score = StrategyScorer::score_fixed(strat, *fixed_metrics);
+            top_heap.push(std::move(strat));
+        }
+        return top_heap.take_sorted();
+    }
+    
+    // Générateurs par partition: tâche globale = offset de la partition + tâche locale
+    const std::vector<std::vector<int>> partitions = expiry_partitions(universe, filter.expiry);
+    if (partitions.size() > 1) {
+        std::cout << "Échéances: " << partitions.size() << " partitions" << std::endl;
+    }
+    std::vector<IntervalDfs> dfs_search;
+    if (dfs) {
+        dfs_search.reserve(partitions.size());
+        for (const auto& part : partitions) {
+            dfs_search.emplace_back(part, allowed, filter);
+        }
+    }
+    
+    for (int n_legs = 1; n_legs <= max_legs; ++n_legs) {
+        size_t level_valid = 0;
+        
+        // ========== ÉTAPE 1: Pré-générer toutes les combinaisons d'indices ==========
+        // (DFS, MITM et CLIQUE: aucune pré-génération, les combinaisons sont construites)
+        std::vector<std::vector<int>> all_combinations;
+        all_combinations.reserve(dfs || mitm || clique ? 0 : 10000);
+        
+        // Combinaisons de positions dans chaque partition, converties en indices du cache
+        // (conversion croissante: l'ordre trié du journal des rejets est conservé)
+        // (contraintes de structure: parcours par strike, StrikeOrderedCombinations)
+        std::vector<int> combo(n_legs);
+        const bool expiry_check = filter.expiry.active() && !filter.expiry.partitioned();
+        auto add_combination = [&](const std::vector<int>& indices) {
+            if (expiry_check) {
+                const int n_expiries = StrategyCalculator::expiry_count(g_cache.options, indices);
+                if (n_expiries < filter.expiry.min_count() || n_expiries > filter.expiry.max_count()) {
+                    return;
+                }
+            }
+            all_combinations.push_back(indices);
+        };
+        for (const auto& part : partitions) {
+            const int part_size = static_cast<int>(part.size());
+            if (dfs || mitm || clique || part_size == 0) {
+                continue;
+            }
+            if (filter.legs.active()) {
+                StrikeOrderedCombinations(part, filter.legs).run(n_legs, add_combination);
+                continue;
+            }
+            std::vector<int> c(n_legs, 0);
+            do {
+                for (int i = 0; i < n_legs; ++i) {
+                    combo[i] = part[c[i]];
+                }
+                add_combination(combo);
+            } while (StrategyCalculator::next_combination(c, part_size));
+        }
+        // Journal: combinaisons triées (recherche dichotomique de la session)
+        if (log_rejections && (partitions.size() > 1 || filter.legs.active())) {
+            std::sort(all_combinations.begin(), all_combinations.end());
+        }
+        
+        const size_t n_combos = all_combinations.size();
+        const int n_masks = 1 << n_legs;
+        const size_t total_tasks = n_combos * n_masks;
+        
+        RejectionLog log;
+        if (log_rejections) {
+            log.n_legs = n_legs;
+            log.reasons.assign(total_tasks, RejectReason::NONE);
+            log.values.assign(total_tasks, 0.0f);
+        }
+        
+        // ========== ÉTAPE 2: Traiter les combinaisons EN PARALLÈLE ==========
+        // Tâche = combo_idx * n_masks + masque; seuls les masques générés sont évalués.
+        // Par partition, DFS: un sous-arbre par position de la première jambe.
+        // MITM: une tâche par moitié gauche. CLIQUE: une tâche par premier nœud du graphe
+        std::vector<MeetInTheMiddle> halves;
+        std::vector<CliqueGenerator> graphs;
+        halves.reserve(mitm ? partitions.size() : 0);
+        graphs.reserve(clique ? partitions.size() : 0);
+        std::vector<size_t> task_offsets{0};
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            size_t part_tasks = 0;
+            if (dfs) {
+                part_tasks = partitions[p].size();
+            } else if (mitm) {
+                halves.emplace_back(partitions[p], allowed, filter, n_legs);
+                part_tasks = halves.back().n_left();
+            } else if (clique) {
+                graphs.emplace_back(partitions[p], allowed, filter, n_legs);
+                part_tasks = graphs.back().n_nodes();
+            }
+            task_offsets.push_back(task_offsets.back() + part_tasks);
+        }
+        const int64_t n_part_tasks = static_cast<int64_t>(task_offsets.back());
+        std::mutex mtx;
+        size_t level_tasks = 0;
+        size_t level_pruned = 0;
+        const int64_t n_combos_signed = static_cast<int64_t>(n_combos);
+        
+        #pragma omp parallel
+        {
+            // Buffer local au thread pour collecter les résultats
+            std::vector<ScoredStrategy> thread_results;
+            thread_results.reserve(1000);
+            TopStrategyHeap thread_heap(top_capacity);
+            size_t thread_valid = 0;
+            size_t thread_tasks = 0;
+            size_t thread_pruned = 0;
+            
+            std::vector<int> combo_signs(n_legs);
+            std::vector<int> free_groups;
+            std::vector<char> generated(log_rejections ? n_masks : 0);
+            std::vector<QuantileSketch>* sketches = rank_columns.empty()
+                ? nullptr
+                : &thread_sketches[static_cast<size_t>(omp_get_thread_num())];
+            
+            auto keep = [&](ScoredStrategy&& strat) {
+                ++thread_valid;
+                if (sketches != nullptr) {
+                    sketch_strategy(*sketches, strat);
+                }
+                if (streaming) {
+                    strat.score = StrategyScorer::score_fixed(strat, *fixed_metrics);
+                    thread_heap.push(std::move(strat));
+                } else {
+                    thread_results.push_back(std::move(strat));
+                }
+            };
+            
+            if (dfs) {
+                std::vector<int> leg_indices(n_legs);
+                
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (int64_t task = 0; task < n_part_tasks; ++task) {
+                    if (stop_flag.load()) {
+                        continue;
+                    }
+                    const size_t p = partition_of(task_offsets, static_cast<size_t>(task));
+                    const int first = static_cast<int>(task - task_offsets[p]);
+                    thread_pruned += dfs_search[p].run(first, leg_indices, combo_signs,
+                        [&](const std::vector<int>& indices, const std::vector<int>& signs) {
+                            ++thread_tasks;
+                            auto strat = evaluate_combination(indices, signs, filter, nullptr, rules);
+                            if (strat.has_value()) {
+                                keep(std::move(strat.value()));
+                            }
+                        });
+                }
+            } else if (mitm) {
+                std::vector<int> leg_indices(n_legs);
+                
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (int64_t task = 0; task < n_part_tasks; ++task) {
+                    if (stop_flag.load()) {
+                        continue;
+                    }
+                    const size_t p = partition_of(task_offsets, static_cast<size_t>(task));
+                    thread_tasks += halves[p].join(static_cast<size_t>(task) - task_offsets[p], leg_indices, combo_signs,
+                        [&](const std::vector<int>& indices, const std::vector<int>& signs) {
+                            auto strat = evaluate_combination(indices, signs, filter, nullptr, rules);
+                            if (strat.has_value()) {
+                                keep(std::move(strat.value()));
+                            }
+                        });
+                }
+            } else if (clique) {
+                std::vector<int> leg_indices(n_legs);
+                
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (int64_t task = 0; task < n_part_tasks; ++task) {
+                    if (stop_flag.load()) {
+                        continue;
+                    }
+                    const size_t p = partition_of(task_offsets, static_cast<size_t>(task));
+                    graphs[p].run(static_cast<size_t>(task) - task_offsets[p], leg_indices, combo_signs,
+                        [&](const std::vector<int>& indices, const std::vector<int>& signs) {
+                            ++thread_tasks;
+                            auto strat = evaluate_combination(indices, signs, filter, nullptr, rules);
+                            if (strat.has_value()) {
+                                keep(std::move(strat.value()));
+                            }
+                        });
+                }
+            } else {
+                #pragma omp for schedule(dynamic, 16) nowait
+                for (int64_t combo_idx = 0; combo_idx < n_combos_signed; ++combo_idx) {
+                    // Check stop flag - use continue instead of throw in OpenMP region
+                    if(stop_flag.load()) {
+                        continue;
+                    }
+                
+                    const auto& indices = all_combinations[combo_idx];
+                    const size_t first_task = static_cast<size_t>(combo_idx) * n_masks;
+                
+                    int fixed = 0;
+                    const bool feasible = combo_sign_masks(indices, allowed, fixed, free_groups);
+                    const int n_generated = feasible ? 1 << free_groups.size() : 0;
+                    // Types des jambes: les comptes ouvert_* de chaque masque sont des popcounts
+                    LegMasks leg_bits = StrategyCalculator::leg_masks(g_cache.options, indices, combo_signs);
+                    thread_tasks += n_generated;
+                    std::fill(generated.begin(), generated.end(), 0);
+                
+                    for (int k = 0; k < n_generated; ++k) {
+                        int mask = fixed;
+                        for (size_t g = 0; g < free_groups.size(); ++g) {
+                            if (k & (1 << g)) {
+                                mask |= free_groups[g];
+                            }
+                        }
+                        for (int i = 0; i < n_legs; ++i) {
+                            combo_signs[i] = (mask & (1 << i)) ? 1 : -1;
+                        }
+                        if (log_rejections) {
+                            generated[mask] = 1;
+                        }
+                        
+                        // Ouvert gauche / droite sans appel au kernel
+                        leg_bits.longs = static_cast<uint32_t>(mask);
+                        if (leg_bits.net_short_puts() > filter.ouvert_gauche) {
+                            if (log_rejections) {
+                                log.reasons[first_task + mask] = RejectReason::PUT_OPEN;
+                                log.values[first_task + mask] = static_cast<float>(leg_bits.net_short_puts());
+                            }
+                            continue;
+                        }
+                        if (leg_bits.net_short_calls() > filter.ouvert_droite) {
+                            if (log_rejections) {
+                                log.reasons[first_task + mask] = RejectReason::CALL_OPEN;
+                                log.values[first_task + mask] = static_cast<float>(leg_bits.net_short_calls());
+                            }
+                            continue;
+                        }
+                    
+                        RejectInfo reject;
+                        auto strat = evaluate_combination(indices, combo_signs, filter,
+                                                          log_rejections ? &reject : nullptr, rules);
+                        if (strat.has_value()) {
+                            keep(std::move(strat.value()));
+                        } else if (log_rejections) {
+                            log.reasons[first_task + mask] = reject.reason;
+                            log.values[first_task + mask] = static_cast<float>(reject.value);
+                        }
+                    }
+                
+                    // Masques non générés: motif journalisé sans évaluation
+                    if (log_rejections) {
+                        for (int mask = 0; mask < n_masks; ++mask) {
+                            if (generated[mask]) {
+                                continue;
+                            }
+                            for (int i = 0; i < n_legs; ++i) {
+                                combo_signs[i] = (mask & (1 << i)) ? 1 : -1;
+                            }
+                            const RejectInfo reject = pruned_mask_reason(indices, combo_signs, permanent, filter);
+                            log.reasons[first_task + mask] = reject.reason;
+                            log.values[first_task + mask] = static_cast<float>(reject.value);
+                        }
+                    }
+                }
+            }
+            
+            // Fusionner les résultats du thread (une seule fois par thread)
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                level_valid += thread_valid;
+                level_tasks += thread_tasks;
+                level_pruned += thread_pruned;
+                if (streaming) {
+                    top_heap.merge(std::move(thread_heap));
+                } else {
+                    valid_strategies.insert(valid_strategies.end(), 
+                        std::make_move_iterator(thread_results.begin()),
+                        std::make_move_iterator(thread_results.end()));
+                }
+            }
+        }
+        
+        // Check stop flag after parallel region completes
+        if (stop_flag.load()) {
+            throw std::runtime_error("Cancelled by user");
+        }
+        
+        if (log_rejections) {
+            log.combos.reserve(n_combos * n_legs);
+            for (const auto& combo : all_combinations) {
+                log.combos.insert(log.combos.end(), combo.begin(), combo.end());
+            }
+            rejections->push_back(std::move(log));
+        }
+        
+        if (dfs) {
+            std::cout << "n_legs=" << n_legs << " dfs taches=" << level_tasks
+                      << " coupes=" << level_pruned
+                      << " valides=" << level_valid << std::endl;
+        } else if (mitm) {
+            size_t n_left = 0;
+            size_t n_right = 0;
+            for (const auto& half : halves) {
+                n_left += half.n_left();
+                n_right += half.n_right();
+            }
+            std::cout << "n_legs=" << n_legs << " mitm moities=" << n_left
+                      << "x" << n_right << " paires=" << level_tasks
+                      << " valides=" << level_valid << std::endl;
+        } else if (clique) {
+            size_t n_edges = 0;
+            for (const auto& graph : graphs) {
+                n_edges += graph.n_edges();
+            }
+            std::cout << "n_legs=" << n_legs << " clique noeuds=" << n_part_tasks
+                      << " aretes=" << n_edges << " taches=" << level_tasks
+                      << " valides=" << level_valid << std::endl;
+        } else {
+            std::cout << "n_legs=" << n_legs << " combos=" << n_combos 
+                      << " taches=" << level_tasks << "/" << total_tasks
+                      << " valides=" << level_valid << std::endl;
+        }
+    }
+    
+    publish_quantiles();
+    if (streaming) {
+        return top_heap.take_sorted();
+    }
+    return valid_strategies;
+}
+
+
+/**
+ * Génère toutes les combinaisons inférieur à n_legs options, les score et retourne le top_n
+ */
+py::list process_combinations_batch_with_scoring(
+    int max_legs,
+    double max_loss_left,
+    double max_loss_right,
+    double max_premium_params,
+    int ouvert_gauche,
+    int ouvert_droite,
+    double min_premium_sell,
+    double delta_min,
+    double delta_max,
+    double limit_left,
+    double limit_right,
+    int top_n = 1000,
+    py::dict custom_weights = py::dict(),
+    const std::string& dedup_mode = "exact",
+    double dedup_tolerance = 0.0,
+    const std::string& selection = "top_n",
+    double mmr_lambda = 0.7,
+    const std::string& diversity = "pnl",
+    int pareto_fronts = 1,
+    py::dict pareto_objectives = py::dict(),
+    bool keep_session = false,
+    size_t session_max_rows = 0,
+    const std::string& group_by = "n_legs",
+    int group_size = 0,
+    py::dict fixed_ranges = py::dict(),
+    py::dict normalizers = py::dict(),
+    py::list rules = py::list(),
+    py::dict custom_metrics = py::dict(),
+    py::dict liquidity = py::dict(),
+    bool use_bid_ask = false,
+    double fee_per_contract = 0.0,
+    bool prune_dominated = false,
+    const std::string& generator = "masks",
+    py::dict search = py::dict(),
+    const std::string& expiry_policy = "any",
+    int max_expiries = 0,
+    py::dict constraints = py::dict()
+) {
+    stop_flag.store(false);
+    
+    const FilterParams filter{
+        max_loss_left, max_loss_right, max_premium_params, ouvert_gauche, ouvert_droite,
+        min_premium_sell, delta_min, delta_max, limit_left, limit_right,
+        parse_liquidity(liquidity), ExecutionCosts{use_bid_ask, fee_per_contract}, prune_dominated,
+        parse_expiry_policy(expiry_policy, max_expiries), parse_constraints(constraints)
+    };
+    
+    const DedupMode dedup = parse_dedup_mode(dedup_mode);
+    const bool near_dedup = dedup != DedupMode::EXACT && dedup_tolerance > 0.0;
+    
+    SelectionConfig selection_config;
+    selection_config.mode = parse_selection_mode(selection);
+    selection_config.mmr_lambda = mmr_lambda;
+    selection_config.diversity = parse_diversity_metric(diversity);
+    selection_config.pareto_fronts = pareto_fronts;
+    selection_config.objectives = parse_objectives(pareto_objectives);
+    selection_config.group_key = parse_group_key(group_by);
+    const bool grouped = selection_config.mode == SelectionMode::GROUPED;
+    const int per_group = group_size > 0 ? group_size : top_n;
+    
+    std::vector<MetricConfig> metrics = build_metric_configs(custom_weights);
+    const RuleProgram rule_program(parse_rules(rules));
+    
+    check_session_options(keep_session, custom_metrics.size() > 0, normalizers.size() > 0);
+    
+    // Métriques personnalisées (absentes des colonnes du store: pas de session)
+    if (custom_metrics.size() > 0) {
+        if (metrics.empty()) {
+            metrics = StrategyScorer::create_default_metrics();
+        }
+        add_custom_metrics(custom_metrics, metrics);
+    }
+    
+    // Normaliseurs par métrique (quantiles alimentés pendant l'énumération)
+    if (normalizers.size() > 0) {
+        if (metrics.empty()) {
+            metrics = StrategyScorer::create_default_metrics();
+        }
+        apply_normalizers(normalizers, metrics);
+    }
+    
+    // Les quasi-doublons éliminent beaucoup plus: classer un pool plus large
+    const int rank_pool = grouped
+        ? per_group * (near_dedup ? NEAR_DEDUP_POOL_FACTOR : GROUP_POOL_FACTOR)
+        : (near_dedup ? top_n * NEAR_DEDUP_POOL_FACTOR : top_n);
+    
+    // Bornes fixes: score final à l'évaluation, un heap borné, aucun store
+    const bool streaming = fixed_ranges.size() > 0;
+    if (streaming) {
+        if (metrics.empty()) {
+            metrics = StrategyScorer::create_default_metrics();
+        }
+        apply_fixed_ranges(fixed_ranges, metrics);
+        StrategyScorer::normalize_weights(metrics);
+        if (!StrategyScorer::all_fixed(metrics)) {
+            throw std::invalid_argument("fixed_ranges: bornes requises pour toutes les métriques de poids non nul");
+        }
+        if (keep_session || grouped || selection_config.mode == SelectionMode::PARETO) {
+            throw std::invalid_argument("fixed_ranges: incompatible avec keep_session, grouped et pareto");
+        }
+    }
+    const bool use_mmr = selection_config.mode == SelectionMode::MMR;
+    const size_t stream_capacity = static_cast<size_t>(rank_pool) *
+        (use_mmr ? std::max(selection_config.mmr_pool_factor, 1) : 1);
+
+    // Journal des rejets pour le refiltre incrémental (store complet uniquement)
+    std::vector<RejectionLog> rejections;
+    const bool log_rejections = keep_session && session_max_rows == 0;
+    
+    const GeneratorMode generator_mode = parse_generator_mode(generator);
+    if (generator_mode != GeneratorMode::MASKS && log_rejections) {
+        throw std::invalid_argument("generator " + generator + ": incompatible avec keep_session sans session_max_rows");
+    }
+    
+    // Recherche heuristique: objectif = métriques du ranking
+    SearchParams search_params = parse_search(search);
+    search_params.objective = metrics.empty() ? StrategyScorer::create_default_metrics() : metrics;
+    
+    std::vector<ScoredStrategy> valid_strategies = enumerate_strategies(
+        max_legs, filter, log_rejections ? &rejections : nullptr,
+        streaming ? &metrics : nullptr, stream_capacity,
+        rule_program.empty() ? nullptr : &rule_program, generator_mode, &search_params,
+        normalizers.size() > 0 ? &metrics : nullptr
+    );
+    
+    // Check stop flag before scoring
+    if (stop_flag.load()) {
+        throw std::runtime_error("Cancelled by user");
+    }
+    
+    // ========== STORE DE SESSION (avant que le ranking ne déplace les gagnants) ==========
+    if (keep_session) {
+        g_session.build(valid_strategies, g_cache.options, filter, session_max_rows, std::move(rejections));
+        g_session.set_rules(rule_program);
+        std::cout << "Store de session: " << g_session.size() << " stratégies" << std::endl;
+    } else {
+        g_session.clear();
+    }
+    
+    // ========== SCORING ET RANKING EN C++ ==========
+    std::vector<ScoredStrategy> ranked_strategies;
+    if (streaming) {
+        // Déjà scorées et triées par l'énumération
+        ranked_strategies = use_mmr
+            ? StrategyScorer::select_mmr(valid_strategies, rank_pool, selection_config)
+            : std::move(valid_strategies);
+        for (size_t i = 0; i < ranked_strategies.size(); ++i) {
+            ranked_strategies[i].rank = static_cast<int>(i + 1);
+        }
+    } else {
+        ranked_strategies = StrategyScorer::score_and_rank(
+            valid_strategies,  
+            metrics,
+            rank_pool,
+            selection_config
+        );
+    }
+        
+    // ========== FILTRE DES DOUBLONS EN C++ ==========
+    if (grouped) {
+        // Groupe par groupe (résultat trié par groupe): per_group uniques chacun
+        std::vector<ScoredStrategy> unique_strategies;
+        auto group_begin = ranked_strategies.begin();
+        while (group_begin != ranked_strategies.end()) {
+            const int group = group_begin->group;
+            auto group_end = std::find_if(group_begin, ranked_strategies.end(),
+                [group](const ScoredStrategy& strat) { return strat.group != group; });
+            std::vector<ScoredStrategy> members(std::make_move_iterator(group_begin), std::make_move_iterator(group_end));
+            std::vector<ScoredStrategy> unique_members = StrategyScorer::remove_duplicates(
+                members, 4, per_group, dedup, dedup_tolerance, g_cache.mixture
+            );
+            for (size_t i = 0; i < unique_members.size(); ++i) {
+                unique_members[i].rank = static_cast<int>(i + 1);
+                unique_strategies.push_back(std::move(unique_members[i]));
+            }
+            group_begin = group_end;
+        }
+        return strategies_to_py(unique_strategies, selection_config.group_key);
+    }
+    
+    std::cout << " Filtre doublons en cours (max " << top_n << " uniques)..." << std::endl;
+    std::vector<ScoredStrategy> unique_strategies = StrategyScorer::remove_duplicates(
+        ranked_strategies, 4, top_n, dedup, dedup_tolerance, g_cache.mixture
+    );
+
+    // ========== CONVERSION EN RÉSULTATS PYTHON ==========
+    return strategies_to_py(unique_strategies);
+}
+
+
+/**
+ * Une seule énumération pour plusieurs profils de poids: colonnes de métriques
+ * et bornes de normalisation (indépendantes des poids) calculées une fois,
+ * puis un heap top_n par profil maintenu dans le même passage
+ *
+ * @return Une liste de résultats (même format que process_combinations_batch_with_scoring) par profil
+ */
+py::list process_combinations_batch_multi_profile(
+    int max_legs,
+    double max_loss_left,
+    double max_loss_right,
+    double max_premium_params,
+    int ouvert_gauche,
+    int ouvert_droite,
+    double min_premium_sell,
+    double delta_min,
+    double delta_max,
+    double limit_left,
+    double limit_right,
+    py::list weight_profiles,
+    int top_n = 1000,
+    py::dict liquidity = py::dict(),
+    bool use_bid_ask = false,
+    double fee_per_contract = 0.0,
+    bool prune_dominated = false,
+    const std::string& generator = "masks",
+    py::dict search = py::dict(),
+    const std::string& expiry_policy = "any",
+    int max_expiries = 0,
+    py::dict constraints = py::dict()
+) {
+    stop_flag.store(false);
+    
+    const FilterParams filter{
+        max_loss_left, max_loss_right, max_premium_params, ouvert_gauche, ouvert_droite,
+        min_premium_sell, delta_min, delta_max, limit_left, limit_right,
+        parse_liquidity(liquidity), ExecutionCosts{use_bid_ask, fee_per_contract}, prune_dominated,
+        parse_expiry_policy(expiry_policy, max_expiries), parse_constraints(constraints)
+    };
+    
+    // Poids normalisés de chaque profil, sur les métriques par défaut
+    const std::vector<MetricConfig> metrics = StrategyScorer::create_default_metrics();
+    std::vector<std::vector<double>> profile_weights;
+    for (const auto& profile : weight_profiles) {
+        std::vector<MetricConfig> profile_metrics = build_metric_configs(profile.cast<py::dict>());
+        if (profile_metrics.empty()) {
+            profile_metrics = metrics;
+        }
+        StrategyScorer::normalize_weights(profile_metrics);
+        std::vector<double> weights;
+        for (const auto& metric : profile_metrics) {
+            weights.push_back(metric.weight);
+        }
+        profile_weights.push_back(std::move(weights));
+    }
+    
+    // Recherche heuristique: objectif = poids moyens des profils
+    SearchParams search_params = parse_search(search);
+    search_params.objective = metrics;
+    for (size_t j = 0; j < metrics.size(); ++j) {
+        double weight = 0.0;
+        for (const auto& weights : profile_weights) {
+            weight += weights[j];
+        }
+        search_params.objective[j].weight = profile_weights.empty() ? 0.0 : weight / profile_weights.size();
+    }
     
-    for (int n_legs = 1; n_legs <= max_legs; ++n_legs) {
-        size_t count_before = valid_strategies.size();
-        
-        // ========== ÉTAPE 1: Pré-générer toutes les combinaisons d'indices ==========
-        std::vector<std::vector<int>> all_combinations;
-        all_combinations.reserve(10000);
-        
-        std::vector<int> c(n_legs, 0);
-        do {
-            all_combinations.push_back(c);
-        } while (StrategyCalculator::next_combination(c, g_cache.n_options));
-        
-        const size_t n_combos = all_combinations.size();
-        const int n_masks = 1 << n_legs;
-        const size_t total_tasks = n_combos * n_masks;
+    std::vector<ScoredStrategy> valid_strategies = enumerate_strategies(
+        max_legs, filter, nullptr, nullptr, 0, nullptr, parse_generator_mode(generator), &search_params
+    );
+    
+    if (stop_flag.load()) {
+        throw std::runtime_error("Cancelled by user");
+    }
+    
+    // ========== SCORING DE TOUS LES PROFILS EN UN PASSAGE ==========
+    const auto columns = StrategyScorer::extract_metric_columns(valid_strategies, metrics);
+    std::vector<double> metric_mins, metric_maxs;
+    StrategyScorer::compute_metric_ranges(columns, metric_mins, metric_maxs);
+    
+    const auto top_indices = StrategyScorer::select_top_indices_multi(
+        columns, metrics, profile_weights, metric_mins, metric_maxs, top_n
+    );
+    
+    // ========== RÉSULTATS PAR PROFIL (copies: un gagnant peut servir plusieurs profils) ==========
+    py::list results;
+    for (size_t p = 0; p < top_indices.size(); ++p) {
+        std::vector<ScoredStrategy> ranked;
+        ranked.reserve(top_indices[p].size());
+        for (size_t idx : top_indices[p]) {
+            ScoredStrategy strat = valid_strategies[idx];
+            strat.score = 0.0;
+            for (size_t j = 0; j < metrics.size(); ++j) {
+                strat.score += profile_weights[p][j] * StrategyScorer::calculate_score(
+                    columns[j][idx], metric_mins[j], metric_maxs[j], metrics[j].scorer);
+            }
+            strat.rank = static_cast<int>(ranked.size() + 1);
+            ranked.push_back(std::move(strat));
+        }
         
-        // ========== ÉTAPE 2: Traiter toutes les tâches EN PARALLÈLE ==========
-        std::vector<ScoredStrategy> local_results;
-        std::mutex mtx;
-        const int64_t total_tasks_signed = static_cast<int64_t>(total_tasks);
+        std::vector<ScoredStrategy> unique_strategies = StrategyScorer::remove_duplicates(ranked, 4, top_n);
+        results.append(strategies_to_py(unique_strategies));
+    }
+    
+    return results;
+}
+
+
+/**
+ * Classe le store de session puis recalcule complètement les seuls gagnants
+ * à partir de leurs jambes (filtres du store)
+ *
+ * @param metrics Métriques de scoring (vide = défaut)
+ * @return Les top_n stratégies uniques, rangs 1..n
+ */
+std::vector<ScoredStrategy> rank_session_strategies(std::vector<MetricConfig> metrics, int top_n) {
+    if (metrics.empty()) {
+        metrics = StrategyScorer::create_default_metrics();
+    }
+    
+    // Pool élargi: les doublons exacts sont retirés après recalcul
+    const auto ranked = g_session.rank(metrics, top_n * RESCORE_POOL_FACTOR);
+    
+    std::vector<ScoredStrategy> winners;
+    winners.reserve(ranked.size());
+    std::vector<int> indices, signs;
+    for (const auto& [row, score] : ranked) {
+        g_session.legs(row, indices, signs);
+        auto strat = evaluate_combination(indices, signs, g_session.filter());
+        if (strat.has_value()) {
+            strat->score = score;
+            strat->rank = static_cast<int>(winners.size() + 1);
+            winners.push_back(std::move(strat.value()));
+        }
+    }
+    
+    std::vector<ScoredStrategy> unique_strategies = StrategyScorer::remove_duplicates(winners, 4, top_n);
+    for (size_t i = 0; i < unique_strategies.size(); ++i) {
+        unique_strategies[i].rank = static_cast<int>(i + 1);
+    }
+    
+    return unique_strategies;
+}
+
+
+py::list rank_session(const py::dict& custom_weights, int top_n) {
+    return strategies_to_py(rank_session_strategies(build_metric_configs(custom_weights), top_n));
+}
+
+
+/**
+ * Re-classe l'ensemble valide du dernier run avec de nouveaux poids, sans
+ * ré-énumérer: scoring sur les colonnes du store, puis recalcul complet des
+ * seuls gagnants à partir de leurs jambes
+ */
+py::list rescore(
+    py::dict custom_weights = py::dict(),
+    int top_n = 10
+) {
+    if (!g_cache.valid || !g_session.valid()) {
+        throw std::runtime_error("Aucun store de session. Lancez process_combinations_batch_with_scoring(keep_session=True).");
+    }
+    return rank_session(custom_weights, top_n);
+}
+
+
+/**
+ * Copie un vecteur dans un tableau numpy 1D
+ */
+py::array_t<double> vector_to_array(const std::vector<double>& values) {
+    py::array_t<double> arr(values.size());
+    auto out = arr.mutable_unchecked<1>();
+    for (size_t i = 0; i < values.size(); ++i) {
+        out(i) = values[i];
+    }
+    return arr;
+}
+
+
+/**
+ * Décomposition du score des top_k stratégies du store de session, pour
+ * re-pondérer côté client: score = sub_scores @ poids. Pour de nouveaux
+ * poids w, le re-tri local est exact tant que le top_n-ième score local
+ * reste >= w . outside_max (sinon une stratégie hors top_k peut monter).
+ */
+py::dict score_decomposition(
+    py::dict custom_weights = py::dict(),
+    int top_k = 1000
+) {
+    if (!g_cache.valid || !g_session.valid()) {
+        throw std::runtime_error("Aucun store de session. Lancez process_combinations_batch_with_scoring(keep_session=True).");
+    }
+    
+    std::vector<MetricConfig> metrics = build_metric_configs(custom_weights);
+    if (metrics.empty()) {
+        metrics = StrategyScorer::create_default_metrics();
+    }
+    
+    const ScoreDecomposition decomposition = g_session.decompose(metrics, top_k);
+    const size_t n_rows = decomposition.rows.size();
+    const size_t n_metrics = decomposition.metric_names.size();
+    
+    py::array_t<double> sub_scores({static_cast<ptrdiff_t>(n_rows), static_cast<ptrdiff_t>(n_metrics)});
+    auto sub_out = sub_scores.mutable_unchecked<2>();
+    for (size_t i = 0; i < n_rows; ++i) {
+        for (size_t j = 0; j < n_metrics; ++j) {
+            sub_out(i, j) = decomposition.sub_scores[i * n_metrics + j];
+        }
+    }
+    
+    py::list indices_list;
+    py::list signs_list;
+    std::vector<int> indices, signs;
+    for (size_t row : decomposition.rows) {
+        g_session.legs(row, indices, signs);
+        indices_list.append(py::cast(indices));
+        signs_list.append(py::cast(signs));
+    }
+    
+    double promotion_bound = 0.0;
+    for (size_t j = 0; j < n_metrics; ++j) {
+        promotion_bound += decomposition.weights[j] * decomposition.outside_max[j];
+    }
+    
+    py::dict result;
+    result["metrics"] = py::cast(decomposition.metric_names);
+    result["weights"] = vector_to_array(decomposition.weights);
+    result["metric_mins"] = vector_to_array(decomposition.metric_mins);
+    result["metric_maxs"] = vector_to_array(decomposition.metric_maxs);
+    result["sub_scores"] = sub_scores;
+    result["scores"] = vector_to_array(decomposition.scores);
+    result["outside_max"] = vector_to_array(decomposition.outside_max);
+    result["promotion_bound"] = promotion_bound;
+    result["indices"] = indices_list;
+    result["signs"] = signs_list;
+    return result;
+}
+
+
+/**
+ * Applique de nouveaux seuils (mêmes limit_left / limit_right) au store de
+ * session: lignes qui ne passent plus retirées, tâches du journal rejetées
+ * sur un seuil relâché ré-évaluées et ajoutées. Le store reste celui d'un
+ * run complet avec ce filtre.
+ */
+void refilter_session(const FilterParams& filter) {
+    // ========== ÉTAPE 1: Seuils resserrés -> retirer des lignes ==========
+    const size_t dropped = g_session.tighten(filter);
+    
+    // ========== ÉTAPE 2: Seuils relâchés -> ré-évaluer les rejets concernés ==========
+    std::vector<ScoredStrategy> added;
+    std::atomic<size_t> reevaluated{0};
+    std::mutex mtx;
+    
+    for (RejectionLog& log : g_session.rejections()) {
+        const int64_t n_tasks = static_cast<int64_t>(log.n_tasks());
         
         #pragma omp parallel
         {
-            // Buffer local au thread pour collecter les résultats
             std::vector<ScoredStrategy> thread_results;
-            thread_results.reserve(1000);
+            std::vector<int> indices, signs;
+            size_t thread_reevaluated = 0;
             
-            #pragma omp for schedule(dynamic, 64) nowait
-            for (int64_t task_id = 0; task_id < total_tasks_signed; ++task_id) {
-                // Check stop flag - use continue instead of throw in OpenMP region
-                if(stop_flag.load()) {
+            #pragma omp for schedule(dynamic, 1024) nowait
+            for (int64_t task = 0; task < n_tasks; ++task) {
+                if (stop_flag.load()) {
                     continue;
                 }
-
-                size_t combo_idx = static_cast<size_t>(task_id) / n_masks;
-                int mask = static_cast<int>(task_id) % n_masks;
-                
-                const auto& indices = all_combinations[combo_idx];
-                
-                // Buffers locaux
-                std::vector<OptionData> combo_options;
-                std::vector<int> combo_signs;
-                std::vector<std::vector<double>> combo_pnl;
-                combo_options.reserve(n_legs);
-                combo_signs.reserve(n_legs);
-                combo_pnl.reserve(n_legs);
-
-                // Construire la combinaison
-                for (int i = 0; i < n_legs; ++i) {
-                    int idx = indices[i];
-                    int sgn = (mask & (1 << i)) ? 1 : -1;
-                    combo_options.push_back(g_cache.options[idx]);
-                    combo_signs.push_back(sgn);
-                    combo_pnl.push_back(g_cache.pnl_matrix[idx]);
+                const RejectReason reason = log.reasons[task];
+                if (reason == RejectReason::NONE ||
+                    !SessionStore::may_pass(reason, log.values[task], filter)) {
+                    continue;
                 }
-            
-                // Calculer les métriques
-                auto result = StrategyCalculator::calculate(
-                    combo_options, combo_signs, combo_pnl, g_cache.prices, g_cache.mixture,
-                    g_cache.average_mix, max_loss_left, max_loss_right, max_premium_params,
-                    ouvert_gauche, ouvert_droite, min_premium_sell, delta_min, delta_max, limit_left, limit_right
-                );
                 
-                if (result.has_value()) {
-                    const auto& metrics = result.value();
-                    
-                    ScoredStrategy strat;
-                    strat.total_premium = metrics.total_premium;
-                    strat.total_delta = metrics.total_delta;
-                    strat.total_gamma = metrics.total_gamma;
-                    strat.total_vega = metrics.total_vega;
-                    strat.total_theta = metrics.total_theta;
-                    strat.total_iv = metrics.total_iv;
-                    strat.avg_implied_volatility = metrics.total_iv / n_legs;
-                    strat.average_pnl = metrics.total_average_pnl;
-                    strat.roll = metrics.total_roll;
-                    strat.roll_quarterly = metrics.total_roll_quarterly;
-                    strat.roll_sum = metrics.total_roll_sum;
-                    strat.sigma_pnl = metrics.total_sigma_pnl;
-                    strat.max_profit = metrics.max_profit;
-                    strat.max_loss = std::min(metrics.max_loss_left, metrics.max_loss_right);
-                    strat.max_loss_left = metrics.max_loss_left;
-                    strat.max_loss_right = metrics.max_loss_right;
-                    strat.min_profit_price = metrics.min_profit_price;
-                    strat.max_profit_price = metrics.max_profit_price;
-                    strat.profit_zone_width = metrics.profit_zone_width;
-                    strat.call_count = metrics.call_count;
-                    strat.put_count = metrics.put_count;
-                    strat.breakeven_points = metrics.breakeven_points;
-                    strat.total_pnl_array = metrics.total_pnl_array;
-                    strat.avg_pnl_levrage = metrics.avg_pnl_levrage;
-                    strat.delta_levrage = metrics.delta_levrage;
-            
-                    strat.option_indices.reserve(n_legs);
-                    strat.signs.reserve(n_legs);
-                    for (int i = 0; i < n_legs; ++i) {
-                        strat.option_indices.push_back(indices[i]);
-                        strat.signs.push_back((mask & (1 << i)) ? 1 : -1);
-                    }
-                    
-                    thread_results.push_back(std::move(strat));
+                ++thread_reevaluated;
+                log.task_legs(task, indices, signs);
+                RejectInfo reject;
+                auto strat = evaluate_combination(indices, signs, filter, &reject, &g_session.rules());
+                if (strat.has_value()) {
+                    log.reasons[task] = RejectReason::NONE;
+                    thread_results.push_back(std::move(strat.value()));
+                } else {
+                    log.reasons[task] = reject.reason;
+                    log.values[task] = static_cast<float>(reject.value);
                 }
             }
             
-            // Fusionner les résultats du thread (une seule fois par thread)
-            {
-                std::lock_guard<std::mutex> lock(mtx);
-                valid_strategies.insert(valid_strategies.end(), 
-                    std::make_move_iterator(thread_results.begin()),
-                    std::make_move_iterator(thread_results.end()));
-            }
-        }
-        
-        // Check stop flag after parallel region completes
-        if (stop_flag.load()) {
-            throw std::runtime_error("Cancelled by user");
+            reevaluated += thread_reevaluated;
+            std::lock_guard<std::mutex> lock(mtx);
+            added.insert(added.end(),
+                std::make_move_iterator(thread_results.begin()),
+                std::make_move_iterator(thread_results.end()));
         }
-        
-        size_t count_after = valid_strategies.size();
-        std::cout << "n_legs=" << n_legs << " combos=" << n_combos 
-                  << " taches=" << total_tasks
-                  << " valides=" << (count_after - count_before) << std::endl;
     }
     
-    // Check stop flag before scoring
+    // Les tâches non ré-évaluées restent journalisées: un nouvel appel les reprend
+    g_session.append(added, g_cache.options);
+    g_session.set_filter(filter);
+    
     if (stop_flag.load()) {
         throw std::runtime_error("Cancelled by user");
     }
     
-    // ========== SCORING ET RANKING EN C++ ==========
-    std::vector<MetricConfig> metrics;
-    if (custom_weights.size() > 0) {
+    std::cout << "Refiltre: " << dropped << " retirées, " << reevaluated.load()
+              << " ré-évaluées, " << added.size() << " ajoutées, total "
+              << g_session.size() << std::endl;
+}
 
-        metrics = StrategyScorer::create_default_metrics();
-        for (auto& metric : metrics) {
-            if (custom_weights.contains(metric.name.c_str())) {
-                metric.weight = custom_weights[metric.name.c_str()].cast<double>();
-            }
-        }
+
+/**
+ * Applique de nouveaux seuils de filtre au dernier run (keep_session=True)
+ * sans ré-énumérer: les lignes du store qui ne passent plus sont retirées,
+ * et seules les tâches rejetées sur un seuil relâché sont ré-évaluées.
+ * Un changement de limit_left / limit_right déplace les zones de perte:
+ * dans ce cas, run complet.
+ */
+py::list refilter(
+    double max_loss_left,
+    double max_loss_right,
+    double max_premium_params,
+    int ouvert_gauche,
+    int ouvert_droite,
+    double min_premium_sell,
+    double delta_min,
+    double delta_max,
+    double limit_left,
+    double limit_right,
+    int top_n = 1000,
+    py::dict custom_weights = py::dict()
+) {
+    stop_flag.store(false);
+    
+    if (!g_cache.valid || !g_session.can_refilter()) {
+        throw std::runtime_error("Aucun journal de session. Lancez process_combinations_batch_with_scoring(keep_session=True, session_max_rows=0).");
     }
     
-    std::vector<ScoredStrategy> ranked_strategies = StrategyScorer::score_and_rank(
-        valid_strategies,  
-        metrics,
-        top_n
-    );
-        
-    // ========== FILTRE DES DOUBLONS EN C++ ==========
-    std::cout << " Filtre doublons en cours (max " << top_n << " uniques)..." << std::endl;
-    std::vector<ScoredStrategy> unique_strategies = StrategyScorer::remove_duplicates(ranked_strategies, 4, top_n);
-
-    // ========== CONVERSION EN RÉSULTATS PYTHON ==========
-    py::list results;
-
+    // Planchers de liquidité, modèle d'exécution, dominance, échéances et contraintes
+    // de structure du run (constants pour la session)
+    const FilterParams filter{
+        max_loss_left, max_loss_right, max_premium_params, ouvert_gauche, ouvert_droite,
+        min_premium_sell, delta_min, delta_max, limit_left, limit_right,
+        g_session.filter().liquidity, g_session.filter().execution, g_session.filter().prune_dominated,
+        g_session.filter().expiry, g_session.filter().legs
+    };
     
-    for (const auto& strat : unique_strategies) {
-        py::list indices_list;
-        py::list signs_list;
-        for (size_t i = 0; i < strat.option_indices.size(); ++i) {
-            indices_list.append(strat.option_indices[i]);
-            signs_list.append(strat.signs[i]);
-        }
-        
-        py::dict metrics_dict;
-        metrics_dict["total_premium"] = strat.total_premium;
-        metrics_dict["total_delta"] = strat.total_delta;
-        metrics_dict["total_gamma"] = strat.total_gamma;
-        metrics_dict["total_vega"] = strat.total_vega;
-        metrics_dict["total_theta"] = strat.total_theta;
-        metrics_dict["total_iv"] = strat.total_iv;
-        metrics_dict["avg_implied_volatility"] = strat.avg_implied_volatility;
-        metrics_dict["average_pnl"] = strat.average_pnl;
-        metrics_dict["total_average_pnl"] = strat.average_pnl;  // Alias pour compatibilité
-        metrics_dict["total_roll"] = strat.roll;
-        metrics_dict["total_roll_quarterly"] = strat.roll_quarterly;
-        metrics_dict["total_roll_sum"] = strat.roll_sum;
-        metrics_dict["sigma_pnl"] = strat.sigma_pnl;
-        metrics_dict["total_sigma_pnl"] = strat.sigma_pnl;  // Alias pour compatibilité
-        metrics_dict["max_profit"] = strat.max_profit;
-        metrics_dict["max_loss"] = strat.max_loss;
-        metrics_dict["max_loss_left"] = strat.max_loss_left;
-        metrics_dict["max_loss_right"] = strat.max_loss_right;
-        metrics_dict["min_profit_price"] = strat.min_profit_price;
-        metrics_dict["max_profit_price"] = strat.max_profit_price;
-        metrics_dict["profit_zone_width"] = strat.profit_zone_width;
-        metrics_dict["call_count"] = strat.call_count;
-        metrics_dict["put_count"] = strat.put_count;
-        metrics_dict["breakeven_points"] = strat.breakeven_points;
-        metrics_dict["score"] = strat.score;
-        metrics_dict["rank"] = strat.rank;
-        metrics_dict["delta_levrage"] = strat.delta_levrage;
-        metrics_dict["avg_pnl_levrage"] = strat.avg_pnl_levrage;
-        
-        // Ajouter le pnl_array
-        py::array_t<double> pnl_arr(strat.total_pnl_array.size());
-        auto pnl_out = pnl_arr.mutable_unchecked<1>();
-        for (size_t i = 0; i < strat.total_pnl_array.size(); ++i) {
-            pnl_out(i) = strat.total_pnl_array[i];
-        }
-        metrics_dict["pnl_array"] = pnl_arr;
-        
-        results.append(py::make_tuple(indices_list, signs_list, metrics_dict));
+    if (limit_left != g_session.filter().limit_left || limit_right != g_session.filter().limit_right) {
+        std::cout << "Refiltre: limites de prix modifiées, run complet" << std::endl;
+        return process_combinations_batch_with_scoring(
+            g_session.max_legs(), max_loss_left, max_loss_right, max_premium_params,
+            ouvert_gauche, ouvert_droite, min_premium_sell, delta_min, delta_max,
+            limit_left, limit_right, top_n, custom_weights,
+            "exact", 0.0, "top_n", 0.7, "pnl", 1, py::dict(), true, 0,
+            "n_legs", 0, py::dict(), py::dict(), rules_to_py(g_session.rules().rules()),
+            py::dict(), liquidity_to_py(filter.liquidity),
+            filter.execution.use_bid_ask, filter.execution.fee_per_contract, filter.prune_dominated,
+            "masks", py::dict(), expiry_mode_name(filter.expiry.mode), filter.expiry.max_expiries,
+            constraints_to_py(filter.legs)
+        );
     }
     
-    return results;
+    refilter_session(filter);
+    
+    return rank_session(custom_weights, top_n);
 }
 
 
@@ -383,6 +2994,10 @@ PYBIND11_MODULE(strategy_metrics_cpp, m) {
           R"pbdoc(
               Initialise le cache global avec toutes les données des options.
               Doit être appelé une seule fois avant process_combinations_batch.
+              open_interests, volumes, bid_sizes, ask_sizes: liquidité optionnelle (0 si absente).
+              bids, asks: cotations optionnelles pour l'exécution (0 = premium mid).
+              expiries: identifiant d'échéance par option (0 si absent: une seule échéance).
+              Vide le store de session du run précédent (keep_session).
           )pbdoc",
           py::arg("premiums"),
           py::arg("deltas"),
@@ -400,12 +3015,68 @@ PYBIND11_MODULE(strategy_metrics_cpp, m) {
           py::arg("pnl_matrix"),
           py::arg("prices"),
           py::arg("mixture"),
-          py::arg("average_mix")
+          py::arg("average_mix"),
+          py::arg("open_interests") = std::nullopt,
+          py::arg("volumes") = std::nullopt,
+          py::arg("bid_sizes") = std::nullopt,
+          py::arg("ask_sizes") = std::nullopt,
+          py::arg("bids") = std::nullopt,
+          py::arg("asks") = std::nullopt,
+          py::arg("expiries") = std::nullopt
     );
     
     m.def("process_combinations_batch_with_scoring", &process_combinations_batch_with_scoring,
           R"pbdoc(
               Génère toutes les combinaisons de n_legs options avec SCORING et RANKING en C++.
+              dedup_mode: "exact" (même payoff), "linf" ou "l2" (quasi-doublons à
+              dedup_tolerance près, P&L pondéré par la mixture).
+              selection: "top_n", "mmr" (score vs diversité, mmr_lambda dans [0, 1],
+              diversity "pnl" ou "legs") ou "pareto" (pareto_fronts premiers fronts non
+              dominés sur pareto_objectives, ex: {"average_pnl": "max", "sigma_pnl": "min"}).
+              keep_session: conserve les métriques de l'ensemble valide pour rescore() et refilter()
+              (session_max_rows > 0 borne le store par un pré-filtre large).
+              selection "grouped": les group_size (défaut top_n) meilleures de chaque
+              groupe group_by ("n_legs", "call_put", "structure" ou "expiry": ensemble
+              des échéances des jambes, ex: "E0+E1"), clé "group".
+              fixed_ranges: bornes {métrique: (lo, hi)} de normalisation fixes; le score
+              est final à l'évaluation et seul un heap borné est conservé (sans store).
+              normalizers: {métrique: "max" | "min_max" | "count" | "percentile" | "robust"};
+              "percentile" score le rang de la valeur, "robust" la place dans médiane +/- 2 IQR
+              (quantiles approchés par sketch, ~1 % d'erreur de rang, alimentés pendant
+              l'énumération). Incompatible avec keep_session.
+              rules: règles évaluées dans le kernel, [(champ, op, valeur) ou
+              (champ, op, facteur, champ2)], ex: [("max_profit", ">=", 3.0, "abs_max_loss"),
+              ("n_breakevens", "<=", 2)]; op parmi <, <=, >, >=, ==, !=.
+              custom_metrics: métriques de scoring définies par expression, {nom: (expression,
+              poids[, scorer])}, ex: {"pnl_per_risk": ("average_pnl / (1 + abs(max_loss))", 0.2)};
+              opérateurs + - * / ^, fonctions abs, sqrt, log, exp, min, max; scorer "higher"
+              (défaut), "lower", "moderate" ou "positive". Utilisables dans normalizers et fixed_ranges.
+              liquidity: planchers par jambe {"min_open_interest", "min_volume", "min_quote_size"}
+              (taille à l'ask pour un achat, au bid pour une vente); les options qui ne
+              passent pour aucun signe sont retirées avant l'énumération.
+              use_bid_ask: achats à l'ask, ventes au bid (cotations de init_options_cache);
+              fee_per_contract: frais par jambe. Premium, P&L et métriques sont exécutables.
+              prune_dominated: ne génère pas les jambes dominées (même type et échéance, payoff au moins
+              aussi bon, prix exécutable au moins aussi bon). Les ventes sous min_premium_sell
+              et les jambes illiquides ne sont jamais générées.
+              generator: "masks" (combinaisons puis masques de signes) ou "dfs" (jambe par
+              jambe, sous-arbres coupés dès que premium, delta ou average_pnl ne peuvent plus
+              passer) ou "mitm" (jonction de demi-stratégies triées par premium, seules les
+              paires dans les fenêtres premium/delta sont évaluées; pour 4 à 6 jambes) ou
+              "clique" (cliques du graphe de compatibilité des jambes, bitsets de 64 bits:
+              même contrat de signes opposés et paires hors fenêtres jamais énumérés).
+              "beam": recherche heuristique non exhaustive (beam search sur l'ajout de
+              jambes puis recuit simulé optionnel), même kernel et objectif = métriques du
+              ranking; réglée par search={"beam_width", "anneal_chains", "anneal_steps",
+              "temperature", "seed", "time_limit"} (résultat reproductible pour une graine).
+              dfs, mitm, clique et beam: incompatibles avec keep_session sans session_max_rows.
+              expiry_policy: "any", "single" (une échéance par stratégie: l'univers est
+              partitionné par échéance, aucune combinaison croisée n'est générée),
+              "at_most" (au plus max_expiries échéances) ou "calendar" (exactement deux).
+              constraints: structure des jambes {"strike_min", "strike_max", "min_spacing",
+              "max_spacing" (écart entre strikes distincts consécutifs), "min_calls", "max_calls",
+              "min_puts", "max_puts", "symmetric_wings" (écarts en palindrome)}; avec "masks",
+              les combinaisons sont parcourues par strike et les plages infaisables sautées.
           )pbdoc",
           py::arg("n_legs"),
           py::arg("max_loss_left"),
@@ -419,6 +3090,104 @@ PYBIND11_MODULE(strategy_metrics_cpp, m) {
           py::arg("limit_left"),
           py::arg("limit_right"),
           py::arg("top_n") = 10,
+          py::arg("custom_weights") = py::dict(),
+          py::arg("dedup_mode") = "exact",
+          py::arg("dedup_tolerance") = 0.0,
+          py::arg("selection") = "top_n",
+          py::arg("mmr_lambda") = 0.7,
+          py::arg("diversity") = "pnl",
+          py::arg("pareto_fronts") = 1,
+          py::arg("pareto_objectives") = py::dict(),
+          py::arg("keep_session") = false,
+          py::arg("session_max_rows") = 0,
+          py::arg("group_by") = "n_legs",
+          py::arg("group_size") = 0,
+          py::arg("fixed_ranges") = py::dict(),
+          py::arg("normalizers") = py::dict(),
+          py::arg("rules") = py::list(),
+          py::arg("custom_metrics") = py::dict(),
+          py::arg("liquidity") = py::dict(),
+          py::arg("use_bid_ask") = false,
+          py::arg("fee_per_contract") = 0.0,
+          py::arg("prune_dominated") = false,
+          py::arg("generator") = "masks",
+          py::arg("search") = py::dict(),
+          py::arg("expiry_policy") = "any",
+          py::arg("max_expiries") = 0,
+          py::arg("constraints") = py::dict()
+    );
+    
+    m.def("process_combinations_batch_multi_profile", &process_combinations_batch_multi_profile,
+          R"pbdoc(
+              Comme process_combinations_batch_with_scoring, pour plusieurs profils de
+              poids (liste de dicts) en une seule énumération. Retourne une liste de
+              résultats par profil, dans l'ordre de weight_profiles. liquidity, use_bid_ask,
+              fee_per_contract, prune_dominated, generator, search, expiry_policy,
+              max_expiries et constraints: comme
+              process_combinations_batch_with_scoring.
+          )pbdoc",
+          py::arg("n_legs"),
+          py::arg("max_loss_left"),
+          py::arg("max_loss_right"),
+          py::arg("max_premium_params"),
+          py::arg("ouvert_gauche"),
+          py::arg("ouvert_droite"),
+          py::arg("min_premium_sell"),
+          py::arg("delta_min"),
+          py::arg("delta_max"),
+          py::arg("limit_left"),
+          py::arg("limit_right"),
+          py::arg("weight_profiles"),
+          py::arg("top_n") = 1000,
+          py::arg("liquidity") = py::dict(),
+          py::arg("use_bid_ask") = false,
+          py::arg("fee_per_contract") = 0.0,
+          py::arg("prune_dominated") = false,
+          py::arg("generator") = "masks",
+          py::arg("search") = py::dict(),
+          py::arg("expiry_policy") = "any",
+          py::arg("max_expiries") = 0,
+          py::arg("constraints") = py::dict()
+    );
+    
+    m.def("rescore", &rescore,
+          R"pbdoc(
+              Re-classe l'ensemble valide du dernier run (keep_session=True) avec de
+              nouveaux poids, sans ré-énumérer. Seuls les top_n gagnants sont recalculés.
+          )pbdoc",
+          py::arg("custom_weights") = py::dict(),
+          py::arg("top_n") = 10
+    );
+    
+    m.def("score_decomposition", &score_decomposition,
+          R"pbdoc(
+              Sous-scores normalisés (top_k x n_metrics) des top_k stratégies du store de
+              session, avec les min/max de normalisation. Re-pondération locale:
+              scores = sub_scores @ w. Le re-tri local est exact tant que le top_n-ième
+              score reste >= w @ outside_max (promotion_bound pour les poids courants).
+          )pbdoc",
+          py::arg("custom_weights") = py::dict(),
+          py::arg("top_k") = 1000
+    );
+    
+    m.def("refilter", &refilter,
+          R"pbdoc(
+              Applique de nouveaux seuils de filtre au dernier run (keep_session=True,
+              session_max_rows=0) sans ré-énumérer: resserrer retire des lignes,
+              relâcher ne ré-évalue que les tâches rejetées sur ce seuil.
+              Modifier limit_left / limit_right relance un run complet.
+          )pbdoc",
+          py::arg("max_loss_left"),
+          py::arg("max_loss_right"),
+          py::arg("max_premium_params"),
+          py::arg("ouvert_gauche"),
+          py::arg("ouvert_droite"),
+          py::arg("min_premium_sell"),
+          py::arg("delta_min"),
+          py::arg("delta_max"),
+          py::arg("limit_left"),
+          py::arg("limit_right"),
+          py::arg("top_n") = 1000,
           py::arg("custom_weights") = py::dict()
     );
 
@@ -1,6 +1,8 @@
 #include "strategy_metrics.hpp"
 #include <numeric>
 #include <cmath>
+#include <utility>
+#include <array>
 
 // ============================================================================
 // CALCULS
@@ -31,9 +33,61 @@ void StrategyCalculator::calculate_greeks(
 }
 
 
+// Kernels spécialisés: 1 à KERNEL_MAX_LEGS jambes, grille de KERNEL_GRID points
+// (num_points par défaut de l'application) ou de longueur quelconque
+static constexpr size_t KERNEL_MAX_LEGS = 6;
+static constexpr size_t KERNEL_GRID = 200;
+
+/**
+ * P&L total à N_LEGS jambes (GRID points, 0 = longueur lue à l'exécution).
+ * Boucle sur la grille, jambes déroulées: un accumulateur en registre par
+ * point, une seule écriture. Même ordre d'addition que la boucle générique
+ * (offset puis jambe 0, 1, ...): résultats identiques au bit près.
+ */
+template <size_t N_LEGS, size_t GRID>
+static void total_pnl_kernel(
+    const std::vector<std::vector<double>>& pnl_matrix,
+    const std::vector<int>& signs,
+    double offset,
+    double* total_pnl,
+    size_t pnl_length
+) {
+    std::array<const double*, N_LEGS> rows;
+    std::array<double, N_LEGS> s;
+    for (size_t i = 0; i < N_LEGS; ++i) {
+        rows[i] = pnl_matrix[i].data();
+        s[i] = static_cast<double>(signs[i]);
+    }
+    const size_t grid = GRID > 0 ? GRID : pnl_length;
+    for (size_t j = 0; j < grid; ++j) {
+        double acc = offset;
+        for (size_t i = 0; i < N_LEGS; ++i) {
+            acc += s[i] * rows[i][j];
+        }
+        total_pnl[j] = acc;
+    }
+}
+
+// Spécialisation (N_LEGS, grille fixe ou non) choisie à l'exécution
+template <size_t N_LEGS>
+static void dispatch_total_pnl(
+    const std::vector<std::vector<double>>& pnl_matrix,
+    const std::vector<int>& signs,
+    double offset,
+    double* total_pnl,
+    size_t pnl_length
+) {
+    if (pnl_length == KERNEL_GRID) {
+        total_pnl_kernel<N_LEGS, KERNEL_GRID>(pnl_matrix, signs, offset, total_pnl, pnl_length);
+    } else {
+        total_pnl_kernel<N_LEGS, 0>(pnl_matrix, signs, offset, total_pnl, pnl_length);
+    }
+}
+
 std::vector<double> StrategyCalculator::calculate_total_pnl(
     const std::vector<std::vector<double>>& pnl_matrix,
-    const std::vector<int>& signs
+    const std::vector<int>& signs,
+    double offset
 ) {
     if (pnl_matrix.empty()) {
         return {};
@@ -42,9 +96,24 @@ std::vector<double> StrategyCalculator::calculate_total_pnl(
     const size_t n_options = pnl_matrix.size();
     const size_t pnl_length = pnl_matrix[0].size();
     
-    std::vector<double> total_pnl(pnl_length, 0.0);
+    std::vector<double> total_pnl(pnl_length, offset);
     
-    // Dot product: signs @ pnl_matrix
+    // Kernels spécialisés (lignes de même longueur que la première)
+    const bool uniform = std::all_of(pnl_matrix.begin(), pnl_matrix.end(),
+        [pnl_length](const std::vector<double>& row) { return row.size() == pnl_length; });
+    if (uniform && n_options <= KERNEL_MAX_LEGS) {
+        double* out = total_pnl.data();
+        switch (n_options) {
+            case 1: dispatch_total_pnl<1>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+            case 2: dispatch_total_pnl<2>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+            case 3: dispatch_total_pnl<3>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+            case 4: dispatch_total_pnl<4>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+            case 5: dispatch_total_pnl<5>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+            case 6: dispatch_total_pnl<6>(pnl_matrix, signs, offset, out, pnl_length); return total_pnl;
+        }
+    }
+    
+    // Chemin générique. Dot product: signs @ pnl_matrix
     for (size_t i = 0; i < n_options; ++i) {
         const double s = static_cast<double>(signs[i]);
         const auto& row = pnl_matrix[i];
@@ -161,4 +230,169 @@ void StrategyCalculator::calculate_surfaces(
     total_sigma_pnl = std::abs(sum_signed_sigma);
 }
 
+
+static inline uint64_t mix_hash(uint64_t h, uint64_t v) {
+    // Mélange type splitmix64 pour combiner les composantes de la forme canonique
+    v += 0x9e3779b97f4a7c15ULL;
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111ebULL;
+    v ^= v >> 31;
+    return (h ^ v) * 0x100000001b3ULL;
+}
+
+uint64_t StrategyCalculator::payoff_fingerprint(
+    const std::vector<OptionData>& options,
+    const std::vector<int>& signs,
+    int decimals
+) {
+    const double factor = std::pow(10.0, decimals);
+    constexpr double strike_factor = 1e6;
+
+    // (strike arrondi, changement de pente net) - n_legs est petit, tri par insertion
+    std::vector<std::pair<long long, int>> kinks;
+    kinks.reserve(options.size());
+
+    int beta = 0;
+    double alpha = 0.0;
+
+    for (size_t i = 0; i < options.size(); ++i) {
+        const int s = signs[i];
+        const long long k = std::llround(options[i].strike * strike_factor);
+
+        // (K - S)+ = (S - K)+ - (S - K) : un put apporte le même coude qu'un call
+        if (!options[i].is_call) {
+            beta -= s;
+            alpha += s * options[i].strike;
+        }
+        alpha -= s * options[i].premium;
+
+        bool merged = false;
+        for (auto& kink : kinks) {
+            if (kink.first == k) {
+                kink.second += s;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            kinks.emplace_back(k, s);
+        }
+    }
+
+    std::sort(kinks.begin(), kinks.end());
+
+    uint64_t h = mix_hash(0xcbf29ce484222325ULL, static_cast<uint64_t>(static_cast<int64_t>(beta)));
+    h = mix_hash(h, static_cast<uint64_t>(std::llround(alpha * factor)));
+    for (const auto& kink : kinks) {
+        if (kink.second == 0) {
+            continue;  // Coudes qui s'annulent (même strike, signes opposés)
+        }
+        h = mix_hash(h, static_cast<uint64_t>(kink.first));
+        h = mix_hash(h, static_cast<uint64_t>(static_cast<int64_t>(kink.second)));
+    }
+
+    return h != 0 ? h : 1;
+}
+
+StructureClass StrategyCalculator::classify_structure(
+    const std::vector<OptionData>& options,
+    const std::vector<int>& signs
+) {
+    struct Position {
+        bool is_call;
+        double strike;
+        int expiry;
+        int qty;
+    };
+    
+    // Positions nettes par contrat (type, strike, échéance), triées par strike
+    std::vector<Position> positions;
+    for (size_t i = 0; i < options.size(); ++i) {
+        auto it = std::find_if(positions.begin(), positions.end(), [&](const Position& p) {
+            return p.is_call == options[i].is_call && p.strike == options[i].strike &&
+                   p.expiry == options[i].expiry;
+        });
+        if (it != positions.end()) {
+            it->qty += signs[i];
+        } else {
+            positions.push_back({options[i].is_call, options[i].strike, options[i].expiry, signs[i]});
+        }
+    }
+    positions.erase(std::remove_if(positions.begin(), positions.end(),
+        [](const Position& p) { return p.qty == 0; }), positions.end());
+    std::sort(positions.begin(), positions.end(), [](const Position& a, const Position& b) {
+        return a.strike < b.strike || (a.strike == b.strike && a.is_call < b.is_call);
+    });
+    
+    const size_t n = positions.size();
+    if (n == 0) {
+        return StructureClass::OTHER;
+    }
+    if (n == 1) {
+        return StructureClass::SINGLE;
+    }
+    
+    // Plusieurs échéances: seul le calendrier simple est reconnu
+    const bool multi_expiry = std::any_of(positions.begin(), positions.end(),
+        [&positions](const Position& p) { return p.expiry != positions[0].expiry; });
+    if (multi_expiry) {
+        const bool calendar = n == 2 && positions[0].is_call == positions[1].is_call &&
+                              positions[0].strike == positions[1].strike &&
+                              positions[0].qty == -positions[1].qty;
+        return calendar ? StructureClass::CALENDAR : StructureClass::OTHER;
+    }
+    
+    int n_calls = 0;
+    for (const auto& p : positions) {
+        n_calls += p.is_call ? 1 : 0;
+    }
+    const bool same_type = n_calls == 0 || n_calls == static_cast<int>(n);
+    
+    // Quantités (dans l'ordre des strikes) égales au motif ou à son opposé
+    auto matches = [&positions](std::initializer_list<int> pattern) {
+        bool direct = true;
+        bool inverse = true;
+        size_t k = 0;
+        for (int q : pattern) {
+            direct = direct && positions[k].qty == q;
+            inverse = inverse && positions[k].qty == -q;
+            ++k;
+        }
+        return direct || inverse;
+    };
+    
+    if (n == 2) {
+        const Position& a = positions[0];
+        const Position& b = positions[1];
+        if (same_type) {
+            if (a.qty * b.qty > 0) return StructureClass::OTHER;
+            return a.qty == -b.qty ? StructureClass::VERTICAL : StructureClass::RATIO_SPREAD;
+        }
+        if (a.qty != b.qty) {
+            return a.qty == -b.qty ? StructureClass::RISK_REVERSAL : StructureClass::OTHER;
+        }
+        return a.strike == b.strike ? StructureClass::STRADDLE : StructureClass::STRANGLE;
+    }
+    
+    if (n == 3 && same_type && matches({1, -2, 1})) {
+        return StructureClass::BUTTERFLY;
+    }
+    
+    if (n == 4) {
+        if (same_type) {
+            return matches({1, -1, -1, 1}) ? StructureClass::CONDOR : StructureClass::OTHER;
+        }
+        // Deux puts en bas, deux calls en haut: put spread + call spread
+        const bool puts_low = !positions[0].is_call && !positions[1].is_call &&
+                              positions[2].is_call && positions[3].is_call;
+        if (puts_low && matches({1, -1, -1, 1})) {
+            return positions[1].strike == positions[2].strike
+                ? StructureClass::IRON_BUTTERFLY
+                : StructureClass::IRON_CONDOR;
+        }
+    }
+    
+    return StructureClass::OTHER;
+}
+
 } // namespace strategy
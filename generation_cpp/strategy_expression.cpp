@@ -0,0 +1,389 @@
+/**
+ * Implémentation des métriques personnalisées (parseur, bytecode, évaluation)
+ */
+
+#include "strategy_expression.hpp"
+#include "strategy_scoring.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace strategy {
+
+// Lignes évaluées par bloc: la pile (max_depth x bloc) reste en cache
+static constexpr size_t EXPR_BLOCK_ROWS = 256;
+
+static const std::pair<const char*, ExprField> EXPR_FIELD_NAMES[] = {
+    {"premium", ExprField::PREMIUM},
+    {"delta", ExprField::DELTA},
+    {"gamma", ExprField::GAMMA},
+    {"vega", ExprField::VEGA},
+    {"theta", ExprField::THETA},
+    {"implied_vol", ExprField::IMPLIED_VOL},
+    {"average_pnl", ExprField::AVERAGE_PNL},
+    {"sigma_pnl", ExprField::SIGMA_PNL},
+    {"roll", ExprField::ROLL},
+    {"roll_quarterly", ExprField::ROLL_QUARTERLY},
+    {"roll_sum", ExprField::ROLL_SUM},
+    {"max_profit", ExprField::MAX_PROFIT},
+    {"max_loss", ExprField::MAX_LOSS},
+    {"max_loss_left", ExprField::MAX_LOSS_LEFT},
+    {"max_loss_right", ExprField::MAX_LOSS_RIGHT},
+    {"min_profit_price", ExprField::MIN_PROFIT_PRICE},
+    {"max_profit_price", ExprField::MAX_PROFIT_PRICE},
+    {"profit_zone_width", ExprField::PROFIT_ZONE_WIDTH},
+    {"delta_levrage", ExprField::DELTA_LEVRAGE},
+    {"avg_pnl_levrage", ExprField::AVG_PNL_LEVRAGE},
+    {"n_legs", ExprField::N_LEGS},
+    {"call_legs", ExprField::CALL_LEGS},
+    {"put_legs", ExprField::PUT_LEGS},
+    {"n_breakevens", ExprField::N_BREAKEVENS},
+    {"liquidity", ExprField::LIQUIDITY},
+};
+
+static const std::pair<const char*, ExprOp> EXPR_FUNCTION_NAMES[] = {
+    {"abs", ExprOp::ABS},
+    {"sqrt", ExprOp::SQRT},
+    {"log", ExprOp::LOG},
+    {"exp", ExprOp::EXP},
+    {"min", ExprOp::MIN},
+    {"max", ExprOp::MAX},
+};
+
+// ============================================================================
+// PARSEUR
+// ============================================================================
+
+class MetricExpression::Parser {
+public:
+    Parser(const std::string& source, std::vector<Instruction>& code)
+        : source_(source), code_(code) {}
+    
+    void parse() {
+        parse_expr();
+        skip_spaces();
+        if (pos_ != source_.size()) {
+            fail("caractère inattendu");
+        }
+    }
+
+private:
+    void fail(const std::string& message) const {
+        throw std::invalid_argument("Expression \"" + source_ + "\": " + message +
+                                    " (position " + std::to_string(pos_) + ")");
+    }
+    
+    void skip_spaces() {
+        while (pos_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[pos_]))) {
+            ++pos_;
+        }
+    }
+    
+    bool accept(char c) {
+        skip_spaces();
+        if (pos_ < source_.size() && source_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+    
+    void expect(char c) {
+        if (!accept(c)) {
+            fail(std::string("'") + c + "' attendu");
+        }
+    }
+    
+    void emit(ExprOp op, ExprField field = ExprField::PREMIUM, double constant = 0.0) {
+        code_.push_back({op, field, constant});
+    }
+    
+    void parse_expr() {
+        parse_term();
+        while (true) {
+            if (accept('+')) {
+                parse_term();
+                emit(ExprOp::ADD);
+            } else if (accept('-')) {
+                parse_term();
+                emit(ExprOp::SUB);
+            } else {
+                return;
+            }
+        }
+    }
+    
+    void parse_term() {
+        parse_unary();
+        while (true) {
+            if (accept('*')) {
+                parse_unary();
+                emit(ExprOp::MUL);
+            } else if (accept('/')) {
+                parse_unary();
+                emit(ExprOp::DIV);
+            } else {
+                return;
+            }
+        }
+    }
+    
+    void parse_unary() {
+        if (accept('-')) {
+            parse_unary();
+            emit(ExprOp::NEG);
+            return;
+        }
+        parse_power();
+    }
+    
+    void parse_power() {
+        parse_primary();
+        if (accept('^')) {
+            parse_unary();
+            emit(ExprOp::POW);
+        }
+    }
+    
+    void parse_primary() {
+        skip_spaces();
+        if (pos_ >= source_.size()) {
+            fail("expression incomplète");
+        }
+        
+        if (accept('(')) {
+            parse_expr();
+            expect(')');
+            return;
+        }
+        
+        const char c = source_[pos_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* begin = source_.c_str() + pos_;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if (end == begin) {
+                fail("nombre invalide");
+            }
+            pos_ += static_cast<size_t>(end - begin);
+            emit(ExprOp::CONST, ExprField::PREMIUM, value);
+            return;
+        }
+        
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const size_t start = pos_;
+            while (pos_ < source_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(source_[pos_])) || source_[pos_] == '_')) {
+                ++pos_;
+            }
+            const std::string name = source_.substr(start, pos_ - start);
+            
+            if (accept('(')) {
+                parse_call(name);
+                return;
+            }
+            for (const auto& [field_name, field] : EXPR_FIELD_NAMES) {
+                if (name == field_name) {
+                    emit(ExprOp::FIELD, field);
+                    return;
+                }
+            }
+            fail("champ inconnu: " + name);
+        }
+        
+        fail("caractère inattendu");
+    }
+    
+    void parse_call(const std::string& name) {
+        for (const auto& [function_name, op] : EXPR_FUNCTION_NAMES) {
+            if (name != function_name) {
+                continue;
+            }
+            parse_expr();
+            if (op == ExprOp::MIN || op == ExprOp::MAX) {
+                expect(',');
+                parse_expr();
+            }
+            expect(')');
+            emit(op);
+            return;
+        }
+        fail("fonction inconnue: " + name);
+    }
+    
+    const std::string& source_;
+    std::vector<Instruction>& code_;
+    size_t pos_ = 0;
+};
+
+// ============================================================================
+// COMPILATION
+// ============================================================================
+
+static bool is_binary(ExprOp op) {
+    switch (op) {
+        case ExprOp::ADD: case ExprOp::SUB: case ExprOp::MUL: case ExprOp::DIV:
+        case ExprOp::POW: case ExprOp::MIN: case ExprOp::MAX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+MetricExpression::MetricExpression(const std::string& source) : source_(source) {
+    Parser(source_, code_).parse();
+    
+    // Profondeur de pile maximale (taille des buffers d'évaluation)
+    size_t depth = 0;
+    for (const Instruction& instr : code_) {
+        if (instr.op == ExprOp::CONST || instr.op == ExprOp::FIELD) {
+            ++depth;
+        } else if (is_binary(instr.op)) {
+            --depth;
+        }
+        max_depth_ = std::max(max_depth_, depth);
+    }
+}
+
+// ============================================================================
+// ÉVALUATION
+// ============================================================================
+
+double MetricExpression::field_value(const ScoredStrategy& strat, ExprField field) {
+    switch (field) {
+        case ExprField::PREMIUM: return strat.total_premium;
+        case ExprField::DELTA: return strat.total_delta;
+        case ExprField::GAMMA: return strat.total_gamma;
+        case ExprField::VEGA: return strat.total_vega;
+        case ExprField::THETA: return strat.total_theta;
+        case ExprField::IMPLIED_VOL: return strat.avg_implied_volatility;
+        case ExprField::AVERAGE_PNL: return strat.average_pnl;
+        case ExprField::SIGMA_PNL: return strat.sigma_pnl;
+        case ExprField::ROLL: return strat.roll;
+        case ExprField::ROLL_QUARTERLY: return strat.roll_quarterly;
+        case ExprField::ROLL_SUM: return strat.roll_sum;
+        case ExprField::MAX_PROFIT: return strat.max_profit;
+        case ExprField::MAX_LOSS: return strat.max_loss;
+        case ExprField::MAX_LOSS_LEFT: return strat.max_loss_left;
+        case ExprField::MAX_LOSS_RIGHT: return strat.max_loss_right;
+        case ExprField::MIN_PROFIT_PRICE: return strat.min_profit_price;
+        case ExprField::MAX_PROFIT_PRICE: return strat.max_profit_price;
+        case ExprField::PROFIT_ZONE_WIDTH: return strat.profit_zone_width;
+        case ExprField::DELTA_LEVRAGE: return strat.delta_levrage;
+        case ExprField::AVG_PNL_LEVRAGE: return strat.avg_pnl_levrage;
+        case ExprField::N_LEGS: return static_cast<double>(strat.option_indices.size());
+        case ExprField::CALL_LEGS: return strat.call_legs;
+        case ExprField::PUT_LEGS: return strat.put_legs;
+        case ExprField::N_BREAKEVENS: return static_cast<double>(strat.breakeven_points.size());
+        case ExprField::LIQUIDITY: return strat.liquidity;
+        default: return 0.0;
+    }
+}
+
+void MetricExpression::evaluate_block(
+    const ScoredStrategy* strategies,
+    size_t n_rows,
+    size_t stride,
+    std::vector<double>& stack,
+    double* out
+) const {
+    // Pile de colonnes: le niveau d occupe [d * stride, d * stride + n_rows)
+    auto level = [&stack, stride](size_t d) { return stack.data() + d * stride; };
+    
+    size_t top = 0;
+    for (const Instruction& instr : code_) {
+        double* a = top >= 1 ? level(top - 1) : nullptr;   // Sommet
+        double* b = top >= 2 ? level(top - 2) : nullptr;   // Sous le sommet
+        
+        switch (instr.op) {
+            case ExprOp::CONST:
+                std::fill(level(top), level(top) + n_rows, instr.constant);
+                ++top;
+                break;
+            case ExprOp::FIELD: {
+                double* push = level(top);
+                for (size_t i = 0; i < n_rows; ++i) {
+                    push[i] = field_value(strategies[i], instr.field);
+                }
+                ++top;
+                break;
+            }
+            // Binaires: b (avant-dernier) op a (dernier), résultat dans b
+            case ExprOp::ADD:
+                for (size_t i = 0; i < n_rows; ++i) b[i] += a[i];
+                --top;
+                break;
+            case ExprOp::SUB:
+                for (size_t i = 0; i < n_rows; ++i) b[i] -= a[i];
+                --top;
+                break;
+            case ExprOp::MUL:
+                for (size_t i = 0; i < n_rows; ++i) b[i] *= a[i];
+                --top;
+                break;
+            case ExprOp::DIV:
+                for (size_t i = 0; i < n_rows; ++i) b[i] /= a[i];
+                --top;
+                break;
+            case ExprOp::POW:
+                for (size_t i = 0; i < n_rows; ++i) b[i] = std::pow(b[i], a[i]);
+                --top;
+                break;
+            case ExprOp::MIN:
+                for (size_t i = 0; i < n_rows; ++i) b[i] = std::min(b[i], a[i]);
+                --top;
+                break;
+            case ExprOp::MAX:
+                for (size_t i = 0; i < n_rows; ++i) b[i] = std::max(b[i], a[i]);
+                --top;
+                break;
+            // Unaires: en place sur le sommet
+            case ExprOp::NEG:
+                for (size_t i = 0; i < n_rows; ++i) a[i] = -a[i];
+                break;
+            case ExprOp::ABS:
+                for (size_t i = 0; i < n_rows; ++i) a[i] = std::abs(a[i]);
+                break;
+            case ExprOp::SQRT:
+                for (size_t i = 0; i < n_rows; ++i) a[i] = std::sqrt(a[i]);
+                break;
+            case ExprOp::LOG:
+                for (size_t i = 0; i < n_rows; ++i) a[i] = std::log(a[i]);
+                break;
+            case ExprOp::EXP:
+                for (size_t i = 0; i < n_rows; ++i) a[i] = std::exp(a[i]);
+                break;
+        }
+    }
+    std::copy(stack.data(), stack.data() + n_rows, out);
+}
+
+std::vector<double> MetricExpression::evaluate(const std::vector<ScoredStrategy>& strategies) const {
+    std::vector<double> values(strategies.size(), 0.0);
+    const int64_t n_blocks = static_cast<int64_t>((strategies.size() + EXPR_BLOCK_ROWS - 1) / EXPR_BLOCK_ROWS);
+    
+    #pragma omp parallel
+    {
+        std::vector<double> stack(std::max<size_t>(max_depth_, 1) * EXPR_BLOCK_ROWS);
+        
+        #pragma omp for schedule(static)
+        for (int64_t b = 0; b < n_blocks; ++b) {
+            const size_t begin = static_cast<size_t>(b) * EXPR_BLOCK_ROWS;
+            const size_t n_rows = std::min(EXPR_BLOCK_ROWS, strategies.size() - begin);
+            evaluate_block(strategies.data() + begin, n_rows, EXPR_BLOCK_ROWS, stack, values.data() + begin);
+        }
+    }
+    return values;
+}
+
+double MetricExpression::evaluate_one(const ScoredStrategy& strat) const {
+    std::vector<double> stack(std::max<size_t>(max_depth_, 1));
+    double value = 0.0;
+    evaluate_block(&strat, 1, 1, stack, &value);
+    return value;
+}
+
+} // namespace strategy
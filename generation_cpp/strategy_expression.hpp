@@ -0,0 +1,117 @@
+/**
+ * Métriques personnalisées - Header
+ * Expressions sur les champs des stratégies (ex: "average_pnl / (1 + abs(max_loss))"),
+ * compilées une fois en bytecode à pile et évaluées par colonnes
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace strategy {
+
+struct ScoredStrategy;
+
+/**
+ * Champs d'une stratégie lisibles par une expression
+ */
+enum class ExprField : uint8_t {
+    PREMIUM,
+    DELTA,
+    GAMMA,
+    VEGA,
+    THETA,
+    IMPLIED_VOL,        // IV moyenne par jambe
+    AVERAGE_PNL,
+    SIGMA_PNL,
+    ROLL,
+    ROLL_QUARTERLY,
+    ROLL_SUM,
+    MAX_PROFIT,
+    MAX_LOSS,
+    MAX_LOSS_LEFT,
+    MAX_LOSS_RIGHT,
+    MIN_PROFIT_PRICE,
+    MAX_PROFIT_PRICE,
+    PROFIT_ZONE_WIDTH,
+    DELTA_LEVRAGE,
+    AVG_PNL_LEVRAGE,
+    N_LEGS,
+    CALL_LEGS,
+    PUT_LEGS,
+    N_BREAKEVENS,
+    LIQUIDITY,
+    COUNT
+};
+
+enum class ExprOp : uint8_t {
+    CONST,
+    FIELD,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    POW,
+    NEG,
+    ABS,
+    SQRT,
+    LOG,
+    EXP,
+    MIN,
+    MAX
+};
+
+/**
+ * Expression compilée (notation postfixe). Grammaire:
+ *   expr    := term (('+' | '-') term)*
+ *   term    := unary (('*' | '/') unary)*
+ *   unary   := '-' unary | power
+ *   power   := primary ('^' unary)?
+ *   primary := nombre | champ | fonction '(' expr [',' expr] ')' | '(' expr ')'
+ * Fonctions: abs, sqrt, log, exp, min, max. Un résultat non fini
+ * (division par zéro, log d'un négatif) donne un sous-score nul.
+ */
+class MetricExpression {
+public:
+    /**
+     * @throws std::invalid_argument si l'expression est invalide
+     */
+    explicit MetricExpression(const std::string& source);
+    
+    const std::string& source() const { return source_; }
+    
+    // Valeur de l'expression pour chaque stratégie (parallèle, par blocs de lignes)
+    std::vector<double> evaluate(const std::vector<ScoredStrategy>& strategies) const;
+    
+    // Valeur pour une seule stratégie (scoring à l'évaluation)
+    double evaluate_one(const ScoredStrategy& strat) const;
+    
+    static double field_value(const ScoredStrategy& strat, ExprField field);
+
+private:
+    struct Instruction {
+        ExprOp op;
+        ExprField field;
+        double constant;
+    };
+    
+    // Parseur récursif: émet les instructions au fil de l'analyse
+    class Parser;
+    
+    // Exécute le bytecode sur n_rows lignes (niveaux de pile espacés de stride)
+    void evaluate_block(
+        const ScoredStrategy* strategies,
+        size_t n_rows,
+        size_t stride,
+        std::vector<double>& stack,
+        double* out
+    ) const;
+    
+    std::string source_;
+    std::vector<Instruction> code_;
+    size_t max_depth_ = 0;
+};
+
+} // namespace strategy
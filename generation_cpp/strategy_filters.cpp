@@ -5,6 +5,8 @@
 #include "strategy_metrics.hpp"
 #include <numeric>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 // ============================================================================
 // FILTRES
@@ -34,10 +36,8 @@ bool StrategyCalculator::filter_same_option_buy_sell(
     
     for (size_t i = 0; i < n; ++i) {
         for (size_t j = i + 1; j < n; ++j) {
-            // Même type (call/put) et même strike mais signes opposés = inutile
-            if (options[i].is_call == options[j].is_call &&
-                options[i].strike == options[j].strike &&
-                signs[i] != signs[j]) {
+            // Même contrat (type, strike, échéance) mais signes opposés = inutile
+            if (same_contract(options[i], options[j]) && signs[i] != signs[j]) {
                 return false;
             }
         }
@@ -46,60 +46,133 @@ bool StrategyCalculator::filter_same_option_buy_sell(
 }
 
 
-bool StrategyCalculator::filter_put_open(
+double StrategyCalculator::min_sold_premium(
     const std::vector<OptionData>& options,
-    const std::vector<int>& signs,
-    int ouvert_gauche
+    const std::vector<int>& signs
 ) {
-    int long_put_count = 0;
-    int short_put_count = 0;
-    int put_count= 0;
-    
+    double min_premium = std::numeric_limits<double>::infinity();
     for (size_t i = 0; i < options.size(); ++i) {
-        if (!options[i].is_call) {
-            if (signs[i] > 0) {
-                ++long_put_count;
-            } else {
-                ++short_put_count;
-            }
+        if (signs[i] < 0) {
+            min_premium = std::min(min_premium, options[i].premium);
         }
     }
-    put_count = short_put_count - long_put_count;
+    return min_premium;
+}
 
-    if (put_count > ouvert_gauche) {
-        return false;
+LegMasks StrategyCalculator::leg_masks(
+    const std::vector<OptionData>& options,
+    const std::vector<int>& signs
+) {
+    LegMasks masks;
+    for (size_t i = 0; i < options.size(); ++i) {
+        masks.legs |= uint32_t{1} << i;
+        masks.calls |= static_cast<uint32_t>(options[i].is_call) << i;
+        masks.longs |= static_cast<uint32_t>(signs[i] > 0) << i;
     }
-    return true;
+    return masks;
 }
 
-bool StrategyCalculator::filter_call_open(
+LegMasks StrategyCalculator::leg_masks(
     const std::vector<OptionData>& options,
-    const std::vector<int>& signs,
-    int ouvert_droite
+    const std::vector<int>& indices,
+    const std::vector<int>& signs
 ) {
-    int long_call_count = 0;
-    int short_call_count = 0;
-    int call_count = 0;
+    LegMasks masks;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        masks.legs |= uint32_t{1} << i;
+        masks.calls |= static_cast<uint32_t>(options[indices[i]].is_call) << i;
+        masks.longs |= static_cast<uint32_t>(signs[i] > 0) << i;
+    }
+    return masks;
+}
 
-    for (size_t i = 0; i < options.size(); ++i) {
-        if (options[i].is_call) {
-            if (signs[i] > 0) {
-                ++long_call_count;
-            } else {
-                ++short_call_count;
-            }
+int StrategyCalculator::expiry_count(
+    const std::vector<OptionData>& options,
+    const std::vector<int>& indices
+) {
+    int count = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; ++j) {
+            seen = options[indices[j]].expiry == options[indices[i]].expiry;
         }
+        count += seen ? 0 : 1;
     }
+    return count;
+}
+
+bool StrategyCalculator::strike_in_window(
+    const OptionData& option,
+    const LegConstraints& legs
+) {
+    auto tol = [](double strike) { return 1e-9 * std::max(1.0, std::abs(strike)); };
+    return option.strike >= legs.strike_min - tol(legs.strike_min) &&
+           option.strike <= legs.strike_max + tol(legs.strike_max);
+}
+
+bool StrategyCalculator::legs_within(
+    const std::vector<OptionData>& options,
+    const std::vector<int>& indices,
+    const LegConstraints& legs
+) {
+    auto tol = [](double strike) { return 1e-9 * std::max(1.0, std::abs(strike)); };
     
-    call_count = short_call_count - long_call_count;
-    
-    if (call_count > ouvert_droite) {
+    int n_calls = 0;
+    std::vector<double> strikes;
+    strikes.reserve(indices.size());
+    for (int index : indices) {
+        const OptionData& option = options[index];
+        n_calls += option.is_call ? 1 : 0;
+        if (!strike_in_window(option, legs)) {
+            return false;
+        }
+        strikes.push_back(option.strike);
+    }
+    const int n_puts = static_cast<int>(indices.size()) - n_calls;
+    if (n_calls < legs.min_calls || n_calls > legs.max_calls ||
+        n_puts < legs.min_puts || n_puts > legs.max_puts) {
         return false;
     }
+    
+    // Écarts entre strikes distincts consécutifs
+    std::sort(strikes.begin(), strikes.end());
+    std::vector<double> gaps;
+    for (size_t i = 1; i < strikes.size(); ++i) {
+        const double gap = strikes[i] - strikes[i - 1];
+        if (gap <= tol(strikes[i])) {
+            continue;
+        }
+        if (gap < legs.min_spacing - tol(strikes[i]) || gap > legs.max_spacing + tol(strikes[i])) {
+            return false;
+        }
+        gaps.push_back(gap);
+    }
+    if (legs.symmetric_wings) {
+        for (size_t i = 0; i < gaps.size() / 2; ++i) {
+            if (std::abs(gaps[i] - gaps[gaps.size() - 1 - i]) > tol(strikes.back())) {
+                return false;
+            }
+        }
+    }
     return true;
 }
 
 
+bool StrategyCalculator::filter_put_open(
+    const LegMasks& masks,
+    int ouvert_gauche
+) {
+    return masks.net_short_puts() <= ouvert_gauche;
+}
+
+bool StrategyCalculator::filter_call_open(
+    const LegMasks& masks,
+    int ouvert_droite
+) {
+    return masks.net_short_calls() <= ouvert_droite;
+}
+
+
 bool StrategyCalculator::filter_premium(
     const std::vector<OptionData>& options,
     const std::vector<int>& signs,
@@ -141,4 +214,168 @@ bool StrategyCalculator::filter_average_pnl(
     return total_average_pnl >= 0.0;
 }
 
+double StrategyCalculator::leg_cost(
+    const OptionData& option,
+    int sign,
+    const ExecutionCosts& costs
+) {
+    double cost = costs.fee_per_contract;
+    if (costs.use_bid_ask) {
+        if (sign > 0 && option.ask > 0.0) {
+            cost += option.ask - option.premium;
+        } else if (sign < 0 && option.bid > 0.0) {
+            cost += option.premium - option.bid;
+        }
+    }
+    return cost;
+}
+
+double StrategyCalculator::apply_execution(
+    std::vector<OptionData>& options,
+    const std::vector<int>& signs,
+    const ExecutionCosts& costs
+) {
+    double total_cost = 0.0;
+    for (size_t i = 0; i < options.size(); ++i) {
+        const double cost = leg_cost(options[i], signs[i], costs);
+        options[i].premium += signs[i] * cost;
+        options[i].average_pnl -= signs[i] * cost;
+        total_cost += cost;
+    }
+    return total_cost;
+}
+
+bool StrategyCalculator::leg_liquid(
+    const OptionData& option,
+    int sign,
+    const LiquidityFloors& floors
+) {
+    const double quote_size = sign > 0 ? option.ask_size : option.bid_size;
+    return option.open_interest >= floors.min_open_interest &&
+           option.volume >= floors.min_volume &&
+           quote_size >= floors.min_quote_size;
+}
+
+bool StrategyCalculator::option_tradable(
+    const OptionData& option,
+    const LiquidityFloors& floors
+) {
+    return leg_liquid(option, 1, floors) || leg_liquid(option, -1, floors);
+}
+
+std::vector<uint8_t> StrategyCalculator::allowed_signs(
+    const std::vector<OptionData>& options,
+    const FilterParams& filter,
+    bool apply_thresholds
+) {
+    const size_t n = options.size();
+    std::vector<uint8_t> allowed(n, 0);
+    std::vector<double> buy_price(n);
+    std::vector<double> sell_credit(n);
+
+    // Prix exécutables (mêmes opérations que apply_execution)
+    for (size_t i = 0; i < n; ++i) {
+        const OptionData& option = options[i];
+        buy_price[i] = option.premium + leg_cost(option, 1, filter.execution);
+        sell_credit[i] = option.premium - leg_cost(option, -1, filter.execution);
+        if (leg_liquid(option, 1, filter.liquidity)) {
+            allowed[i] |= SIGN_LONG;
+        }
+        if (leg_liquid(option, -1, filter.liquidity)) {
+            allowed[i] |= SIGN_SHORT;
+        }
+    }
+
+    // Dominance: j remplace i dans toute stratégie sans dégrader premium ni payoff
+    // (même type et même échéance: les payoffs se comparent à la même date).
+    // À égalité parfaite (même strike, même prix) l'index le plus bas est gardé,
+    // ce qui exclut les cycles: chaque option retirée a un dominant conservé.
+    if (filter.prune_dominated) {
+        const std::vector<uint8_t> liquid = allowed;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n && (allowed[i] & (SIGN_LONG | SIGN_SHORT)); ++j) {
+                if (j == i || options[j].is_call != options[i].is_call ||
+                    options[j].expiry != options[i].expiry) {
+                    continue;
+                }
+                const bool call = options[i].is_call;
+                const double k_i = options[i].strike;
+                const double k_j = options[j].strike;
+                const bool same_strike = k_j == k_i;
+                const bool pays_more = call ? k_j <= k_i : k_j >= k_i;  // payoff_j >= payoff_i
+                const bool pays_less = call ? k_j >= k_i : k_j <= k_i;  // payoff_j <= payoff_i
+
+                if ((allowed[i] & SIGN_LONG) && (liquid[j] & SIGN_LONG) &&
+                    pays_more && buy_price[j] <= buy_price[i] &&
+                    (!same_strike || buy_price[j] < buy_price[i] || j < i)) {
+                    allowed[i] &= ~SIGN_LONG;
+                }
+                if ((allowed[i] & SIGN_SHORT) && (liquid[j] & SIGN_SHORT) &&
+                    pays_less && sell_credit[j] >= sell_credit[i] &&
+                    (!same_strike || sell_credit[j] > sell_credit[i] || j < i)) {
+                    allowed[i] &= ~SIGN_SHORT;
+                }
+            }
+        }
+    }
+
+    // Vente inutile: même test que filter_useless_sell sur le premium exécutable
+    if (apply_thresholds) {
+        for (size_t i = 0; i < n; ++i) {
+            if (sell_credit[i] < filter.min_premium_sell) {
+                allowed[i] &= ~SIGN_SHORT;
+            }
+        }
+    }
+    return allowed;
+}
+
+// ============================================================================
+// RÈGLES DÉCLARATIVES
+// ============================================================================
+
+RuleProgram::RuleProgram(std::vector<FilterRule> rules) : rules_(std::move(rules)) {
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        const FilterRule& rule = rules_[r];
+        Stage stage = stage_of(rule.lhs);
+        if (rule.has_rhs) {
+            stage = std::max(stage, stage_of(rule.rhs));
+        }
+        stages_[stage].push_back({
+            static_cast<uint8_t>(rule.lhs), static_cast<uint8_t>(rule.rhs), rule.op,
+            rule.has_rhs, rule.factor, rule.value, static_cast<int>(r)
+        });
+    }
+}
+
+RuleProgram::Stage RuleProgram::stage_of(RuleField field) {
+    return field < RuleField::MAX_PROFIT ? PRE_PNL : POST_PNL;
+}
+
+int RuleProgram::first_failure(Stage stage, const Fields& fields) const {
+    for (const Instruction& instr : stages_[stage]) {
+        const double lhs = fields[instr.lhs];
+        const double rhs = instr.has_rhs ? instr.factor * fields[instr.rhs] : instr.value;
+        if (!std::isfinite(lhs) || !std::isfinite(rhs)) {
+            return instr.rule;
+        }
+        
+        // Égalité à l'arrondi près (les champs sont des sommes de flottants)
+        const bool equal = std::abs(lhs - rhs) <= 1e-9 * std::max(1.0, std::abs(rhs));
+        bool pass = false;
+        switch (instr.op) {
+            case RuleOp::LT: pass = lhs < rhs && !equal; break;
+            case RuleOp::LE: pass = lhs <= rhs || equal; break;
+            case RuleOp::GT: pass = lhs > rhs && !equal; break;
+            case RuleOp::GE: pass = lhs >= rhs || equal; break;
+            case RuleOp::EQ: pass = equal; break;
+            case RuleOp::NE: pass = !equal; break;
+        }
+        if (!pass) {
+            return instr.rule;
+        }
+    }
+    return -1;
+}
+
 } // namespace strategy
\ No newline at end of file
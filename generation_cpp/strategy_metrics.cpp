@@ -5,13 +5,18 @@
 
 #include "strategy_metrics.hpp"
 #include "strategy_scoring.hpp"
+#include "strategy_session.hpp"
 #include <numeric>
+#include <limits>
 #include <cmath>
 
 // Inclure les implémentations séparées (unity build)
 #include "strategy_filters.cpp"
 #include "strategy_calculs.cpp"
 #include "strategy_scoring.cpp"
+#include "strategy_session.cpp"
+#include "strategy_sketch.cpp"
+#include "strategy_expression.cpp"
 
 // Note: strategy_filters.cpp et strategy_calculs.cpp définissent leurs fonctions
 // dans le namespace strategy, donc pas besoin de rouvrir le namespace ici.
@@ -55,62 +60,69 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
     double delta_min,
     double delta_max,
     double limit_left,
-    double limit_right
+    double limit_right,
+    RejectInfo* reject,
+    const RuleProgram* rules,
+    double execution_cost
 ) {
     const size_t n_options = options.size();
     
+    // Rejet avec motif (la valeur est celle sur laquelle le filtre a échoué)
+    auto rejected = [reject](RejectReason reason, double value) -> std::optional<StrategyMetrics> {
+        if (reject) {
+            reject->reason = reason;
+            reject->value = value;
+        }
+        return std::nullopt;
+    };
+    
     // Validation de base
     if (n_options == 0 || n_options != signs.size() || 
         n_options != pnl_matrix.size() || prices.empty()) {
-        return std::nullopt;
+        return rejected(RejectReason::INVALID, 0.0);
     }
     
     // ========== FILTRES (early exit) ==========
     
     // Filtre 1: Vente inutile (premium < min_premium_sell)
     if (!filter_useless_sell(options, signs, min_premium_sell)) {
-        return std::nullopt;
+        return rejected(RejectReason::USELESS_SELL, min_sold_premium(options, signs));
     }
     
     // Filtre 3: Achat et vente de la même option
     if (!filter_same_option_buy_sell(options, signs)) {
-        return std::nullopt;
+        return rejected(RejectReason::SAME_OPTION, 0.0);
     }
     
-    // Filtre 4: Put count (ouvert_gauche)
-    int put_count;
-    int long_put_count = 0;
-    for (size_t i = 0; i < options.size(); ++i) {
-        if (!options[i].is_call && signs[i] > 0) {
-            ++long_put_count;
-        }
-    }
-    if (!filter_put_open(options, signs, ouvert_gauche)) {
-        return std::nullopt;
+    // Filtre 4: Put open (ouvert_gauche), compte en masques de bits
+    const LegMasks masks = leg_masks(options, signs);
+    const int put_count = masks.net_short_puts();
+    if (!filter_put_open(masks, ouvert_gauche)) {
+        return rejected(RejectReason::PUT_OPEN, put_count);
     }
     
     // Filtre 4b: Call open (ouvert_droite)
-    int call_count_check;
-    if (!filter_call_open(options, signs, ouvert_droite)) {
-        return std::nullopt;
+    const int call_count = masks.net_short_calls();
+    if (!filter_call_open(masks, ouvert_droite)) {
+        return rejected(RejectReason::CALL_OPEN, call_count);
     }
     
     // Filtre 5: Premium
     double total_premium;
     if (!filter_premium(options, signs, max_premium_params, total_premium)) {
-        return std::nullopt;
+        return rejected(RejectReason::PREMIUM, std::abs(total_premium));
     }
     
     // Filtre 6: Delta (avec bornes min/max)
     double total_delta;
     if (!filter_delta(options, signs, delta_min, delta_max, total_delta)) {
-        return std::nullopt;
+        return rejected(RejectReason::DELTA, total_delta);
     }
     
     // Filtre 7: Average P&L
     double total_average_pnl;
     if (!filter_average_pnl(options, signs, total_average_pnl)) {
-        return std::nullopt;
+        return rejected(RejectReason::AVERAGE_PNL, total_average_pnl);
     }
     
     // ========== CALCULS ==========
@@ -119,15 +131,60 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
     double total_gamma, total_vega, total_theta, total_iv;
     calculate_greeks(options, signs, total_gamma, total_vega, total_theta, total_iv);
     
+    // Calcul des rolls
+    double total_roll = 0.0;
+    double total_roll_quarterly = 0.0;
+    double total_roll_sum = 0.0;
+    for (size_t i = 0; i < options.size(); ++i) {
+        total_roll += signs[i] * options[i].roll;
+        total_roll_quarterly += signs[i] * options[i].roll_quarterly;
+        total_roll_sum += signs[i] * options[i].roll_sum;
+    }
+    
+    double delta_lvg = delta_levrage(total_delta, total_premium);
+    double avg_pnl_lvg= avg_pnl_levrage(total_average_pnl, total_premium);
+    
+    const int call_legs = masks.call_legs();
+    double liquidity = std::numeric_limits<double>::max();
+    int expiry_set = 0;
+    for (const auto& option : options) {
+        liquidity = std::min(liquidity, option.open_interest);
+        expiry_set |= 1 << std::clamp(option.expiry, 0, 30);
+    }
+    
+    // ========== RÈGLES DÉCLARATIVES (avant le P&L) ==========
+    const bool use_rules = rules != nullptr && !rules->empty();
+    RuleProgram::Fields fields{};
+    if (use_rules) {
+        fields[static_cast<size_t>(RuleField::PREMIUM)] = total_premium;
+        fields[static_cast<size_t>(RuleField::ABS_PREMIUM)] = std::abs(total_premium);
+        fields[static_cast<size_t>(RuleField::DELTA)] = total_delta;
+        fields[static_cast<size_t>(RuleField::GAMMA)] = total_gamma;
+        fields[static_cast<size_t>(RuleField::VEGA)] = total_vega;
+        fields[static_cast<size_t>(RuleField::THETA)] = total_theta;
+        fields[static_cast<size_t>(RuleField::IMPLIED_VOL)] = total_iv / n_options;
+        fields[static_cast<size_t>(RuleField::AVERAGE_PNL)] = total_average_pnl;
+        fields[static_cast<size_t>(RuleField::ROLL)] = total_roll;
+        fields[static_cast<size_t>(RuleField::ROLL_QUARTERLY)] = total_roll_quarterly;
+        fields[static_cast<size_t>(RuleField::DELTA_LEVRAGE)] = delta_lvg;
+        fields[static_cast<size_t>(RuleField::AVG_PNL_LEVRAGE)] = avg_pnl_lvg;
+        fields[static_cast<size_t>(RuleField::N_LEGS)] = static_cast<double>(n_options);
+        fields[static_cast<size_t>(RuleField::CALL_LEGS)] = call_legs;
+        fields[static_cast<size_t>(RuleField::PUT_LEGS)] = static_cast<double>(n_options) - call_legs;
+        
+        const int failed = rules->first_failure(RuleProgram::PRE_PNL, fields);
+        if (failed >= 0) {
+            return rejected(RejectReason::RULE, failed);
+        }
+    }
+    
     // P&L total
-    std::vector<double> total_pnl = calculate_total_pnl(pnl_matrix, signs);
+    std::vector<double> total_pnl = calculate_total_pnl(pnl_matrix, signs, -execution_cost);
     
     if (total_pnl.empty()) {
-        return std::nullopt;
+        return rejected(RejectReason::INVALID, 0.0);
     }
 
-    double delta_lvg = delta_levrage(total_delta, total_premium);
-    double avg_pnl_lvg= avg_pnl_levrage(total_average_pnl, total_premium);
     // ========== FILTRES DE PERTE BASÉS SUR LES LIMITES DE PRIX ==========
     
     double max_loss_left = 0.0;
@@ -140,7 +197,7 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
         if (price < limit_left) {
             // Zone gauche: vérifier contre max_loss_left_param
             if (pnl < -max_loss_left_param) {
-                return std::nullopt;
+                return rejected(RejectReason::LOSS_LEFT, pnl);
             }
             if (pnl < max_loss_left) {
                 max_loss_left = pnl;
@@ -148,7 +205,7 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
         } else if (price > limit_right) {
             // Zone droite: vérifier contre max_loss_right_param
             if (pnl < -max_loss_right_param) {
-                return std::nullopt;
+                return rejected(RejectReason::LOSS_RIGHT, pnl);
             }
             if (pnl < max_loss_right) {
                 max_loss_right = pnl;
@@ -156,7 +213,7 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
         } else {
             // Zone centrale: la perte ne doit pas dépasser le premium payé
             if (pnl < -std::abs(total_premium)) {
-                return std::nullopt;
+                return rejected(RejectReason::LOSS_CENTER, pnl);
             }
         }
     }
@@ -204,14 +261,24 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
         }
     }
     
-    // Calcul des rolls
-    double total_roll = 0.0;
-    double total_roll_quarterly = 0.0;
-    double total_roll_sum = 0.0;
-    for (size_t i = 0; i < options.size(); ++i) {
-        total_roll += signs[i] * options[i].roll;
-        total_roll_quarterly += signs[i] * options[i].roll_quarterly;
-        total_roll_sum += signs[i] * options[i].roll_sum;
+    // ========== RÈGLES DÉCLARATIVES (après le P&L) ==========
+    if (use_rules && rules->has_stage(RuleProgram::POST_PNL)) {
+        const double zone_loss = std::min(max_loss_left, max_loss_right);
+        fields[static_cast<size_t>(RuleField::MAX_PROFIT)] = max_profit;
+        fields[static_cast<size_t>(RuleField::MAX_LOSS)] = zone_loss;
+        fields[static_cast<size_t>(RuleField::ABS_MAX_LOSS)] = std::abs(zone_loss);
+        fields[static_cast<size_t>(RuleField::MAX_LOSS_LEFT)] = max_loss_left;
+        fields[static_cast<size_t>(RuleField::MAX_LOSS_RIGHT)] = max_loss_right;
+        fields[static_cast<size_t>(RuleField::SIGMA_PNL)] = total_sigma_pnl;
+        fields[static_cast<size_t>(RuleField::MIN_PROFIT_PRICE)] = min_profit_price;
+        fields[static_cast<size_t>(RuleField::MAX_PROFIT_PRICE)] = max_profit_price;
+        fields[static_cast<size_t>(RuleField::PROFIT_ZONE_WIDTH)] = profit_zone_width;
+        fields[static_cast<size_t>(RuleField::N_BREAKEVENS)] = static_cast<double>(breakeven_points.size());
+        
+        const int failed = rules->first_failure(RuleProgram::POST_PNL, fields);
+        if (failed >= 0) {
+            return rejected(RejectReason::RULE, failed);
+        }
     }
     
     // ========== CONSTRUCTION DU RÉSULTAT ==========
@@ -237,10 +304,16 @@ std::optional<StrategyMetrics> StrategyCalculator::calculate(
     result.total_roll = total_roll;
     result.total_roll_quarterly = total_roll_quarterly;
     result.total_roll_sum = total_roll_sum;
-    result.call_count = call_count_check;
+    result.call_count = call_count;
     result.put_count = put_count;
     result.delta_levrage = delta_lvg;
     result.avg_pnl_levrage =avg_pnl_lvg;
+    result.liquidity = liquidity;
+    result.payoff_key = payoff_fingerprint(options, signs);
+    result.structure = classify_structure(options, signs);
+    result.call_legs = call_legs;
+    result.put_legs = static_cast<int>(n_options) - call_legs;
+    result.expiry_set = expiry_set;
     
     return result;
 }
@@ -7,12 +7,36 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <cmath>
 #include <algorithm>
 #include <optional>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace strategy {
 
+/**
+ * Classe structurelle d'une stratégie (positions nettes triées par strike)
+ */
+enum class StructureClass : uint8_t {
+    SINGLE,             // Une seule position
+    VERTICAL,           // Même type, +1/-1
+    RATIO_SPREAD,       // Même type, quantités inégales
+    STRADDLE,           // Call + put même strike, même sens
+    STRANGLE,           // Call + put strikes différents, même sens
+    RISK_REVERSAL,      // Call + put sens opposés
+    BUTTERFLY,          // Même type, +1/-2/+1 (ou inverse)
+    CONDOR,             // Même type, +1/-1/-1/+1 (ou inverse)
+    IRON_BUTTERFLY,     // Put spread + call spread, shorts au même strike
+    IRON_CONDOR,        // Put spread + call spread, shorts à des strikes différents
+    CALENDAR,           // Même type et strike, sens opposés sur deux échéances
+    OTHER
+};
+
 /**
  * Structure légère retournée par les calculs C++
  * Contient toutes les métriques calculées
@@ -40,8 +64,12 @@ struct StrategyMetrics {
     double profit_zone_width;
     
     // Counts
-    int call_count;
-    int put_count;
+    int call_count;         // Calls shorts non couverts (shorts - longs)
+    int put_count;          // Puts shorts non couverts (shorts - longs)
+    int call_legs;          // Nombre de jambes call
+    int put_legs;           // Nombre de jambes put
+    StructureClass structure;
+    int expiry_set;         // Échéances des jambes (bit i = rang i, rangs > 30 sur le bit 30)
     
     // Roll
     double total_roll;
@@ -52,11 +80,17 @@ struct StrategyMetrics {
     double delta_levrage;
     double avg_pnl_levrage;
     
+    // Liquidité: plus petit open interest des jambes (jambe la moins liquide)
+    double liquidity;
+    
     // Breakeven points (max 10 pour éviter allocation dynamique)
     std::vector<double> breakeven_points;
     
     // P&L array complet
     std::vector<double> total_pnl_array;
+
+    // Empreinte canonique du payoff à l'expiration (voir payoff_fingerprint)
+    uint64_t payoff_key;
 };
 
 
@@ -76,10 +110,313 @@ struct OptionData {
     double roll;            // Roll moyen (normalisé)
     double roll_quarterly;  // Roll Q-1 (trimestre précédent)
     double roll_sum;        // Roll brut (non normalisé)
+    double open_interest;   // Liquidité (0 si inconnue)
+    double volume;
+    double bid_size;        // Taille au bid (exécution d'une vente)
+    double ask_size;        // Taille à l'ask (exécution d'un achat)
+    double bid;             // Cotations (0 si inconnues: exécution au premium mid)
+    double ask;
+    int expiry;             // Identifiant d'échéance (rang chronologique, 0 si unique)
     bool is_call;
     // pnl_array sera passé séparément comme matrice
 };
 
+/**
+ * Même contrat: même type, strike et échéance. Acheter et vendre le même
+ * contrat s'annule; deux échéances différentes forment un calendrier.
+ */
+inline bool same_contract(const OptionData& a, const OptionData& b) {
+    return a.is_call == b.is_call && a.strike == b.strike && a.expiry == b.expiry;
+}
+
+// Opérations de bits portables (MSVC, GCC, Clang)
+inline int popcount64(uint64_t x) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+inline int count_trailing_zeros64(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+/**
+ * Combinaison en masques de bits (bit i = jambe i): type et sens de chaque
+ * jambe. Les comptes des filtres ouvert_gauche / ouvert_droite sont des
+ * popcounts, sans branchement ni accès aux données des options.
+ */
+struct LegMasks {
+    uint32_t legs = 0;      // Toutes les jambes
+    uint32_t calls = 0;     // Jambes call
+    uint32_t longs = 0;     // Jambes achetées (masque de signes de l'énumération)
+    
+    int long_calls() const { return popcount64(calls & longs); }
+    int short_calls() const { return popcount64(calls & ~longs & legs); }
+    int long_puts() const { return popcount64(~calls & longs & legs); }
+    int short_puts() const { return popcount64(~calls & ~longs & legs); }
+    int call_legs() const { return popcount64(calls); }
+    // Jambes shorts non couvertes (shorts - longs) par type
+    int net_short_calls() const { return short_calls() - long_calls(); }
+    int net_short_puts() const { return short_puts() - long_puts(); }
+};
+
+
+/**
+ * Planchers de liquidité par jambe (0 = inactif). La taille de cotation est
+ * celle du côté exécuté: ask_size pour un achat, bid_size pour une vente.
+ */
+struct LiquidityFloors {
+    double min_open_interest = 0.0;
+    double min_volume = 0.0;
+    double min_quote_size = 0.0;
+    
+    bool active() const {
+        return min_open_interest > 0.0 || min_volume > 0.0 || min_quote_size > 0.0;
+    }
+};
+
+
+/**
+ * Modèle d'exécution: achat à l'ask, vente au bid, frais par contrat.
+ * Le coût d'une jambe (demi-spread du côté exécuté + frais) décale son
+ * premium et son P&L: les lignes de la matrice P&L restent au mid.
+ */
+struct ExecutionCosts {
+    bool use_bid_ask = false;
+    double fee_per_contract = 0.0;
+    
+    bool active() const { return use_bid_ask || fee_per_contract != 0.0; }
+};
+
+
+/**
+ * Politique d'échéances des jambes: toutes les combinaisons (ANY), une seule
+ * échéance (SINGLE), au plus max_expiries échéances (AT_MOST) ou calendrier
+ * (CALENDAR: exactement deux échéances)
+ */
+enum class ExpiryMode : uint8_t {
+    ANY,
+    SINGLE,
+    AT_MOST,
+    CALENDAR
+};
+
+struct ExpiryPolicy {
+    ExpiryMode mode = ExpiryMode::ANY;
+    int max_expiries = 0;   // AT_MOST uniquement
+    
+    bool active() const { return mode != ExpiryMode::ANY; }
+    // Nombre d'échéances distinctes admis dans une stratégie
+    int min_count() const { return mode == ExpiryMode::CALENDAR ? 2 : 1; }
+    int max_count() const {
+        switch (mode) {
+            case ExpiryMode::SINGLE: return 1;
+            case ExpiryMode::AT_MOST: return max_expiries;
+            case ExpiryMode::CALENDAR: return 2;
+            default: return std::numeric_limits<int>::max();
+        }
+    }
+    // Une échéance par partition de l'univers: aucune combinaison croisée générée
+    bool partitioned() const { return max_count() == 1; }
+};
+
+
+/**
+ * Contraintes de structure des jambes (inactives par défaut), sur les strikes
+ * distincts triés: fenêtre [strike_min, strike_max], écart entre strikes
+ * consécutifs dans [min_spacing, max_spacing], nombres de calls et de puts
+ * bornés, ailes symétriques (écarts en palindrome: verticals, flies et condors
+ * à ailes égales)
+ */
+struct LegConstraints {
+    double strike_min = -std::numeric_limits<double>::infinity();
+    double strike_max = std::numeric_limits<double>::infinity();
+    double min_spacing = 0.0;
+    double max_spacing = std::numeric_limits<double>::infinity();
+    int min_calls = 0;
+    int max_calls = std::numeric_limits<int>::max();
+    int min_puts = 0;
+    int max_puts = std::numeric_limits<int>::max();
+    bool symmetric_wings = false;
+    
+    bool active() const {
+        return std::isfinite(strike_min) || std::isfinite(strike_max) || min_spacing > 0.0 ||
+               std::isfinite(max_spacing) || min_calls > 0 || min_puts > 0 ||
+               max_calls < std::numeric_limits<int>::max() ||
+               max_puts < std::numeric_limits<int>::max() || symmetric_wings;
+    }
+};
+
+
+// Signes autorisés d'une option (masque de allowed_signs)
+constexpr uint8_t SIGN_LONG = 1;
+constexpr uint8_t SIGN_SHORT = 2;
+
+
+/**
+ * Paramètres des filtres de calculate (regroupés pour la session)
+ */
+struct FilterParams {
+    double max_loss_left;
+    double max_loss_right;
+    double max_premium_params;
+    int ouvert_gauche;
+    int ouvert_droite;
+    double min_premium_sell;
+    double delta_min;
+    double delta_max;
+    double limit_left;
+    double limit_right;
+    LiquidityFloors liquidity{};    // Constants pour une session (hors refiltre)
+    ExecutionCosts execution{};
+    bool prune_dominated = false;   // Retirer les jambes dominées (voir allowed_signs)
+    ExpiryPolicy expiry{};
+    LegConstraints legs{};
+};
+
+
+/**
+ * Premier filtre ayant rejeté une stratégie (ordre d'évaluation de calculate)
+ */
+enum class RejectReason : uint8_t {
+    NONE = 0,       // Stratégie valide
+    INVALID,        // Entrées incohérentes, P&L vide
+    USELESS_SELL,   // Vente sous min_premium_sell
+    SAME_OPTION,    // Achat et vente de la même option
+    PUT_OPEN,       // Puts shorts non couverts > ouvert_gauche
+    CALL_OPEN,      // Calls shorts non couverts > ouvert_droite
+    PREMIUM,        // |premium| > max_premium
+    DELTA,          // Delta hors [delta_min, delta_max]
+    AVERAGE_PNL,    // Average P&L < 0
+    LOSS_LEFT,      // Perte < -max_loss_left sous limit_left
+    LOSS_RIGHT,     // Perte < -max_loss_right au-dessus de limit_right
+    LOSS_CENTER,    // Perte > premium entre les limites
+    RULE,           // Règle déclarative en échec (valeur = index de la règle)
+    LIQUIDITY,      // Jambe sous un plancher de liquidité (valeur = index de la jambe)
+    DOMINATED,      // Jambe dominée par une autre option (valeur = index de la jambe)
+    EXPIRY,         // Échéances hors politique (valeur = nombre d'échéances distinctes)
+    STRUCTURE       // Contraintes de structure des jambes (LegConstraints) en échec
+};
+
+/**
+ * Motif de rejet et valeur sur laquelle le filtre a échoué
+ * (premium de la vente, compte ouvert, |premium|, delta ou P&L selon le motif)
+ */
+struct RejectInfo {
+    RejectReason reason = RejectReason::NONE;
+    double value = 0.0;
+};
+
+
+/**
+ * Champs utilisables dans les règles de filtre. Ceux qui précèdent MAX_PROFIT
+ * sont connus avant le calcul du P&L (étape PRE_PNL), les autres après.
+ */
+enum class RuleField : uint8_t {
+    PREMIUM,
+    ABS_PREMIUM,
+    DELTA,
+    GAMMA,
+    VEGA,
+    THETA,
+    IMPLIED_VOL,        // IV moyenne par jambe
+    AVERAGE_PNL,
+    ROLL,
+    ROLL_QUARTERLY,
+    DELTA_LEVRAGE,
+    AVG_PNL_LEVRAGE,
+    N_LEGS,
+    CALL_LEGS,
+    PUT_LEGS,
+    // Après calcul du P&L
+    MAX_PROFIT,
+    MAX_LOSS,           // min(max_loss_left, max_loss_right), comme côté Python
+    ABS_MAX_LOSS,
+    MAX_LOSS_LEFT,
+    MAX_LOSS_RIGHT,
+    SIGMA_PNL,
+    MIN_PROFIT_PRICE,
+    MAX_PROFIT_PRICE,
+    PROFIT_ZONE_WIDTH,
+    N_BREAKEVENS,
+    COUNT
+};
+
+enum class RuleOp : uint8_t {
+    LT,
+    LE,
+    GT,
+    GE,
+    EQ,
+    NE
+};
+
+/**
+ * Règle déclarative: lhs op value, ou lhs op factor * rhs (ratio entre champs)
+ * ex: max_profit >= 3 * abs_max_loss, n_breakevens <= 2
+ */
+struct FilterRule {
+    RuleField lhs = RuleField::PREMIUM;
+    RuleOp op = RuleOp::LE;
+    double value = 0.0;
+    bool has_rhs = false;
+    RuleField rhs = RuleField::PREMIUM;
+    double factor = 1.0;
+};
+
+/**
+ * Règles compilées en programme plat, une liste d'instructions par étape:
+ * calculate évalue chaque étape dès que ses champs sont disponibles
+ * (une règle entre deux champs prend l'étape la plus tardive)
+ */
+class RuleProgram {
+public:
+    static constexpr size_t N_FIELDS = static_cast<size_t>(RuleField::COUNT);
+    using Fields = std::array<double, N_FIELDS>;
+    
+    enum Stage : uint8_t {
+        PRE_PNL = 0,
+        POST_PNL = 1
+    };
+    
+    RuleProgram() = default;
+    explicit RuleProgram(std::vector<FilterRule> rules);
+    
+    bool empty() const { return rules_.empty(); }
+    bool has_stage(Stage stage) const { return !stages_[stage].empty(); }
+    const std::vector<FilterRule>& rules() const { return rules_; }
+    
+    static Stage stage_of(RuleField field);
+    
+    /**
+     * Index (ordre d'origine) de la première règle de l'étape en échec,
+     * -1 si toutes passent. Un champ non fini fait échouer la règle.
+     */
+    int first_failure(Stage stage, const Fields& fields) const;
+
+private:
+    struct Instruction {
+        uint8_t lhs;
+        uint8_t rhs;
+        RuleOp op;
+        bool has_rhs;
+        double factor;
+        double value;
+        int rule;
+    };
+    
+    std::vector<FilterRule> rules_;
+    std::array<std::vector<Instruction>, 2> stages_;
+};
+
 
 /**
  * Classe principale pour les calculs de stratégie
@@ -105,6 +442,11 @@ public:
      * @param delta_max Delta maximum autorisé
      * @param limit_left Left limit we accept to loose max loss left
      * @param limit_right Right limit where we accept to loose max loss right
+     * @param reject Optionnel: reçoit le motif et la valeur du rejet
+     * @param rules Optionnel: règles déclaratives évaluées dans le calcul
+     * @param execution_cost Coût d'exécution total (apply_execution): le P&L
+     *        est décalé de -execution_cost, premium et average_pnl des options
+     *        sont déjà ajustés
      * @return std::optional<StrategyMetrics> - nullopt si invalide
      */
 
@@ -125,7 +467,10 @@ public:
         double delta_min,
         double delta_max,
         double limit_left,
-        double limit_right
+        double limit_right,
+        RejectInfo* reject = nullptr,
+        const RuleProgram* rules = nullptr,
+        double execution_cost = 0.0
     );
 
     static bool next_combination(
@@ -133,6 +478,140 @@ public:
         const int N
     );
 
+    /**
+     * Empreinte exacte du payoff à l'expiration, en O(legs).
+     *
+     * Le payoff étant linéaire par morceaux, il s'écrit de façon unique
+     *   alpha + beta * S + sum_K c_K * max(S - K, 0)
+     * avec c_K le changement de pente net au strike K (calls et puts confondus),
+     * beta = -sum(signes des puts) et alpha = sum(s * K des puts) - premium net.
+     * Deux stratégies ont la même empreinte ssi leurs payoffs coïncident
+     * (à l'arrondi près sur les strikes et sur alpha).
+     *
+     * @param decimals Nombre de décimales conservées pour alpha
+     * @return Hash 64 bits non nul de la forme canonique
+     */
+    static uint64_t payoff_fingerprint(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& signs,
+        int decimals = 4
+    );
+
+    /**
+     * Classe structurelle (vertical, butterfly, iron condor, ...) à partir
+     * des positions nettes agrégées par (type, strike)
+     */
+    static StructureClass classify_structure(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& signs
+    );
+    
+    /**
+     * Plus petit premium vendu (+inf sans jambe short)
+     */
+    static double min_sold_premium(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& signs
+    );
+    
+    /**
+     * Coût d'exécution d'une jambe par rapport au mid: ask - premium pour un
+     * achat, premium - bid pour une vente (si la cotation est connue), plus les frais
+     */
+    static double leg_cost(
+        const OptionData& option,
+        int sign,
+        const ExecutionCosts& costs
+    );
+    
+    /**
+     * Passe les options d'une combinaison au prix exécutable (premium + s * coût,
+     * average_pnl - s * coût)
+     *
+     * @return Coût d'exécution total, à passer à calculate
+     */
+    static double apply_execution(
+        std::vector<OptionData>& options,
+        const std::vector<int>& signs,
+        const ExecutionCosts& costs
+    );
+    
+    /**
+     * La jambe (option, signe) passe-t-elle les planchers de liquidité ?
+     */
+    static bool leg_liquid(
+        const OptionData& option,
+        int sign,
+        const LiquidityFloors& floors
+    );
+    
+    /**
+     * L'option peut-elle servir de jambe pour au moins un signe ?
+     * Sinon elle est retirée de l'univers d'énumération
+     */
+    static bool option_tradable(
+        const OptionData& option,
+        const LiquidityFloors& floors
+    );
+    
+    /**
+     * Signes autorisés par option (SIGN_LONG | SIGN_SHORT), calculés avant
+     * l'énumération. Un signe est retiré si la jambe échoue les planchers de
+     * liquidité, si filter.prune_dominated et qu'une autre option du même type
+     * a un payoff au moins aussi bon à un prix exécutable au moins aussi bon
+     * (achat: payoff >= et prix <=; vente: payoff <= et crédit >=), ou, avec
+     * apply_thresholds, si la vente est sous min_premium_sell.
+     * Seul min_premium_sell dépend de seuils re-filtrables.
+     */
+    static std::vector<uint8_t> allowed_signs(
+        const std::vector<OptionData>& options,
+        const FilterParams& filter,
+        bool apply_thresholds
+    );
+    
+    /**
+     * Masques de bits des jambes options[i] de signes signs[i]
+     */
+    static LegMasks leg_masks(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& signs
+    );
+    
+    /**
+     * Masques de bits des jambes options[indices[i]] de signes signs[i]
+     */
+    static LegMasks leg_masks(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& indices,
+        const std::vector<int>& signs
+    );
+    
+    /**
+     * Nombre d'échéances distinctes parmi options[indices]
+     */
+    static int expiry_count(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& indices
+    );
+    
+    /**
+     * Strike de l'option dans la fenêtre [strike_min, strike_max] des contraintes
+     */
+    static bool strike_in_window(
+        const OptionData& option,
+        const LegConstraints& legs
+    );
+    
+    /**
+     * Jambes options[indices] conformes aux contraintes de structure
+     * (strikes comparés à 1e-9 près en relatif)
+     */
+    static bool legs_within(
+        const std::vector<OptionData>& options,
+        const std::vector<int>& indices,
+        const LegConstraints& legs
+    );
+
 private:
     // Filtres (retourne false si la stratégie doit être rejetée)
 
@@ -148,14 +627,12 @@ private:
     );
     
     static bool filter_put_open(
-        const std::vector<OptionData>& options,
-        const std::vector<int>& signs,
+        const LegMasks& masks,
         int ouvert_gauche
     );
     
     static bool filter_call_open(
-        const std::vector<OptionData>& options,
-        const std::vector<int>& signs,
+        const LegMasks& masks,
         int ouvert_droite
     );
     
@@ -190,9 +667,11 @@ private:
         double& total_iv
     );
     
+    // P&L total: offset + signs @ pnl_matrix
     static std::vector<double> calculate_total_pnl(
         const std::vector<std::vector<double>>& pnl_matrix,
-        const std::vector<int>& signs
+        const std::vector<int>& signs,
+        double offset = 0.0
     );
     
     static void calculate_profit_zone(
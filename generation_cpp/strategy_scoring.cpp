@@ -7,9 +7,15 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
 #include <limits>
+#include <stdexcept>
+#include <memory>
+#include <random>
+#include <iterator>
 
 namespace strategy {
 
@@ -39,9 +45,21 @@ std::vector<MetricConfig> StrategyScorer::create_default_metrics() {
     metrics.emplace_back("delta_levrage", 0.08, NormalizerType::MAX, ScorerType::HIGHER_BETTER);
     metrics.emplace_back("avg_pnl_levrage", 0.08, NormalizerType::MAX, ScorerType::HIGHER_BETTER);
     
+    // Liquidité (inactive par défaut: poids via custom_weights)
+    metrics.emplace_back("liquidity", 0.0, NormalizerType::MAX, ScorerType::HIGHER_BETTER);
+    
     return metrics;
 }
 
+std::vector<ObjectiveConfig> StrategyScorer::create_default_objectives() {
+    std::vector<ObjectiveConfig> objectives;
+    objectives.emplace_back("average_pnl", true);
+    objectives.emplace_back("sigma_pnl", false);
+    objectives.emplace_back("max_loss", true);
+    objectives.emplace_back("premium", false);
+    return objectives;
+}
+
 // ============================================================================
 // NORMALISATION DES POIDS
 // ============================================================================
@@ -220,56 +238,180 @@ double StrategyScorer::calculate_score(
 // FILTRE DE DOUBLONS - OPTIMISÉ AVEC HASH
 // ============================================================================
 
-// Fonction de hash pour un vecteur de P&L arrondi
-static size_t hash_pnl_array(const std::vector<double>& pnl, int decimals) {
-    double factor = std::pow(10.0, decimals);
-    size_t hash = 0;
+// Hash 64 bits du P&L array complet arrondi (repli quand payoff_key est absente)
+static uint64_t hash_pnl_array(const std::vector<double>& pnl, int decimals) {
+    const double factor = std::pow(10.0, decimals);
+    uint64_t hash = 0xcbf29ce484222325ULL;
     
-    // Échantillonner quelques points pour le hash (début, milieu, fin)
-    std::vector<size_t> sample_indices;
-    if (pnl.size() > 0) sample_indices.push_back(0);
-    if (pnl.size() > 10) sample_indices.push_back(pnl.size() / 4);
-    if (pnl.size() > 5) sample_indices.push_back(pnl.size() / 2);
-    if (pnl.size() > 10) sample_indices.push_back(3 * pnl.size() / 4);
-    if (pnl.size() > 1) sample_indices.push_back(pnl.size() - 1);
-    
-    for (size_t idx : sample_indices) {
-        long long rounded = static_cast<long long>(std::round(pnl[idx] * factor));
-        hash ^= std::hash<long long>{}(rounded) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    for (double value : pnl) {
+        const long long rounded = std::llround(value * factor);
+        hash ^= static_cast<uint64_t>(rounded) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
     }
     return hash;
 }
 
-bool StrategyScorer::are_pnl_equal(
-    const std::vector<double>& pnl1,
-    const std::vector<double>& pnl2,
-    int decimals
-) {
-    // Vérifier la taille
-    if (pnl1.size() != pnl2.size()) {
-        return false;
+// ============================================================================
+// QUASI-DOUBLONS - LSH SUR LES PROFILS P&L
+// ============================================================================
+
+/**
+ * Index LSH des profils P&L déjà retenus.
+ *  - NEAR_L2: projections p-stables h = floor((a.x + b) / w) sur le P&L pondéré
+ *  - NEAR_LINF: échantillonnage de coordonnées h = floor((x_c + b) / w)
+ * Chaque table concatène HASHES_PER_TABLE fonctions; deux profils à distance
+ * <= tolérance partagent un bucket dans au moins une table avec forte probabilité.
+ */
+class NearDuplicateIndex {
+public:
+    static constexpr int N_TABLES = 10;
+    static constexpr int HASHES_PER_TABLE = 4;
+
+    NearDuplicateIndex(
+        DedupMode mode,
+        double tolerance,
+        const std::vector<double>& weights,
+        size_t grid_size,
+        uint64_t seed = 42
+    ) : mode_(mode), tolerance_(tolerance), grid_size_(grid_size),
+        // Cellules larges devant la tolérance: P(collision) >= 1 - tol/w par coordonnée
+        width_((mode == DedupMode::NEAR_L2 ? 4.0 : 8.0) * tolerance) {
+        
+        // Poids normalisés des points de grille (uniforme par défaut)
+        point_weights_.assign(grid_size, 1.0 / std::max<size_t>(grid_size, 1));
+        if (weights.size() == grid_size) {
+            double total = 0.0;
+            for (double w : weights) total += std::max(w, 0.0);
+            if (total > 0.0) {
+                for (size_t i = 0; i < grid_size; ++i) {
+                    point_weights_[i] = std::max(weights[i], 0.0) / total;
+                }
+            }
+        }
+        
+        // Support: points de probabilité non négligeable
+        const double max_w = *std::max_element(point_weights_.begin(), point_weights_.end());
+        for (size_t i = 0; i < grid_size; ++i) {
+            if (point_weights_[i] > max_w * 1e-9) {
+                support_.push_back(static_cast<int>(i));
+            }
+        }
+        
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> offset(0.0, width_);
+        const int n_hashes = N_TABLES * HASHES_PER_TABLE;
+        offsets_.resize(n_hashes);
+        for (auto& b : offsets_) b = offset(rng);
+        
+        if (mode_ == DedupMode::NEAR_L2) {
+            std::normal_distribution<double> gauss(0.0, 1.0);
+            projections_.resize(static_cast<size_t>(n_hashes) * grid_size);
+            for (int h = 0; h < n_hashes; ++h) {
+                for (size_t i = 0; i < grid_size; ++i) {
+                    projections_[h * grid_size + i] = gauss(rng) * std::sqrt(point_weights_[i]);
+                }
+            }
+        } else {
+            std::uniform_int_distribution<size_t> pick(0, support_.size() - 1);
+            coordinates_.resize(n_hashes);
+            for (auto& c : coordinates_) c = support_[pick(rng)];
+        }
     }
     
-    // Calculer le facteur de multiplication pour l'arrondi
-    double factor = std::pow(10.0, decimals);
+    bool accepts(const std::vector<double>& pnl) const {
+        return pnl.size() == grid_size_ && !support_.empty() && width_ > 0.0;
+    }
     
-    // Comparer chaque valeur avec tolérance
-    for (size_t i = 0; i < pnl1.size(); ++i) {
-        double rounded1 = std::round(pnl1[i] * factor) / factor;
-        double rounded2 = std::round(pnl2[i] * factor) / factor;
-        
-        if (std::abs(rounded1 - rounded2) > 1e-10) {
-            return false;
+    // Une clé de bucket par table (l'id de la table est mélangé dans la clé)
+    void signatures(const std::vector<double>& pnl, uint64_t* out) const {
+        for (int t = 0; t < N_TABLES; ++t) {
+            uint64_t key = 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(t + 1);
+            for (int k = 0; k < HASHES_PER_TABLE; ++k) {
+                const int h = t * HASHES_PER_TABLE + k;
+                double projected;
+                if (mode_ == DedupMode::NEAR_L2) {
+                    const double* a = &projections_[static_cast<size_t>(h) * grid_size_];
+                    projected = 0.0;
+                    for (size_t i = 0; i < grid_size_; ++i) {
+                        projected += a[i] * pnl[i];
+                    }
+                } else {
+                    projected = pnl[coordinates_[h]];
+                }
+                const long long cell = static_cast<long long>(std::floor((projected + offsets_[h]) / width_));
+                key ^= static_cast<uint64_t>(cell) + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+            }
+            out[t] = key;
         }
     }
     
-    return true;
-}
+    double distance(const std::vector<double>& a, const std::vector<double>& b) const {
+        if (mode_ == DedupMode::NEAR_L2) {
+            double sum = 0.0;
+            for (int i : support_) {
+                const double d = a[i] - b[i];
+                sum += point_weights_[i] * d * d;
+            }
+            return std::sqrt(sum);
+        }
+        double max_diff = 0.0;
+        for (int i : support_) {
+            max_diff = std::max(max_diff, std::abs(a[i] - b[i]));
+        }
+        return max_diff;
+    }
+    
+    bool has_near(
+        const std::vector<double>& pnl,
+        const uint64_t* sig,
+        const std::vector<ScoredStrategy>& uniques
+    ) {
+        ++stamp_;
+        for (int t = 0; t < N_TABLES; ++t) {
+            auto it = buckets_.find(sig[t]);
+            if (it == buckets_.end()) continue;
+            for (uint32_t idx : it->second) {
+                // Un même candidat peut apparaître dans plusieurs tables
+                if (checked_[idx] == stamp_) continue;
+                checked_[idx] = stamp_;
+                if (distance(pnl, uniques[idx].total_pnl_array) <= tolerance_) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+    
+    void insert(const uint64_t* sig, uint32_t unique_idx) {
+        if (sig != nullptr) {
+            for (int t = 0; t < N_TABLES; ++t) {
+                buckets_[sig[t]].push_back(unique_idx);
+            }
+        }
+        checked_.push_back(0);
+    }
+
+private:
+    DedupMode mode_;
+    double tolerance_;
+    size_t grid_size_;
+    double width_;
+    std::vector<double> point_weights_;
+    std::vector<int> support_;
+    std::vector<double> offsets_;
+    std::vector<double> projections_;
+    std::vector<int> coordinates_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets_;
+    std::vector<uint64_t> checked_;
+    uint64_t stamp_ = 0;
+};
 
 std::vector<ScoredStrategy> StrategyScorer::remove_duplicates(
     const std::vector<ScoredStrategy>& strategies,
     int decimals,
-    int max_unique
+    int max_unique,
+    DedupMode mode,
+    double tolerance,
+    const std::vector<double>& weights
 ) {
     if (strategies.empty()) {
         return {};
@@ -278,36 +420,73 @@ std::vector<ScoredStrategy> StrategyScorer::remove_duplicates(
     std::vector<ScoredStrategy> uniques;
     uniques.reserve(max_unique > 0 ? max_unique : strategies.size());
     
-    std::unordered_map<size_t, std::vector<size_t>> hash_buckets;
+    std::unordered_set<uint64_t> seen_keys;
+    seen_keys.reserve(uniques.capacity());
+    
+    // Index LSH uniquement en mode quasi-doublons
+    std::unique_ptr<NearDuplicateIndex> near_index;
+    if (mode != DedupMode::EXACT && tolerance > 0.0) {
+        const size_t grid_size = strategies.front().total_pnl_array.size();
+        if (grid_size > 0) {
+            near_index = std::make_unique<NearDuplicateIndex>(mode, tolerance, weights, grid_size);
+        }
+    }
     
     int duplicates_count = 0;
+    int near_duplicates_count = 0;
     
-    // Pour chaque stratégie
-    for (size_t idx = 0; idx < strategies.size(); ++idx) {
-        // Arrêter dès qu'on a assez de stratégies uniques
-        if (max_unique > 0 && static_cast<int>(uniques.size()) >= max_unique) {
-            break;
-        }
-        
-        const auto& strat = strategies[idx];
-        size_t pnl_hash = hash_pnl_array(strat.total_pnl_array, decimals);
-        
-        bool is_duplicate = false;
+    // Traitement par blocs: signatures LSH calculées en parallèle, puis
+    // sélection gloutonne séquentielle (ordre de rang préservé)
+    constexpr size_t BLOCK_SIZE = 4096;
+    std::vector<uint64_t> block_sigs;
+    bool full = false;
+    
+    for (size_t begin = 0; begin < strategies.size() && !full; begin += BLOCK_SIZE) {
+        const size_t end = std::min(strategies.size(), begin + BLOCK_SIZE);
         
-        // Vérifier uniquement dans le bucket du même hash
-        if (hash_buckets.count(pnl_hash) > 0) {
-            for (size_t unique_idx : hash_buckets[pnl_hash]) {
-                if (are_pnl_equal(strat.total_pnl_array, uniques[unique_idx].total_pnl_array, decimals)) {
-                    is_duplicate = true;
-                    duplicates_count++;
-                    break;
+        if (near_index) {
+            block_sigs.assign((end - begin) * NearDuplicateIndex::N_TABLES, 0);
+            const int64_t block_len = static_cast<int64_t>(end - begin);
+            #pragma omp parallel for schedule(static)
+            for (int64_t i = 0; i < block_len; ++i) {
+                const auto& pnl = strategies[begin + i].total_pnl_array;
+                if (near_index->accepts(pnl)) {
+                    near_index->signatures(pnl, &block_sigs[i * NearDuplicateIndex::N_TABLES]);
                 }
             }
         }
         
-        // Si pas un doublon, l'ajouter
-        if (!is_duplicate) {
-            hash_buckets[pnl_hash].push_back(uniques.size());
+        for (size_t idx = begin; idx < end; ++idx) {
+            // Arrêter dès qu'on a assez de stratégies uniques
+            if (max_unique > 0 && static_cast<int>(uniques.size()) >= max_unique) {
+                full = true;
+                break;
+            }
+            
+            const auto& strat = strategies[idx];
+            
+            // Empreinte canonique calculée dans le kernel: le test de doublon est O(1)
+            const uint64_t key = strat.payoff_key != 0
+                ? strat.payoff_key
+                : hash_pnl_array(strat.total_pnl_array, decimals);
+            
+            if (!seen_keys.insert(key).second) {
+                duplicates_count++;
+                continue;
+            }
+            
+            if (near_index && near_index->accepts(strat.total_pnl_array)) {
+                const uint64_t* sig = &block_sigs[(idx - begin) * NearDuplicateIndex::N_TABLES];
+                if (near_index->has_near(strat.total_pnl_array, sig, uniques)) {
+                    near_duplicates_count++;
+                    continue;
+                }
+                near_index->insert(sig, static_cast<uint32_t>(uniques.size()));
+            } else if (near_index) {
+                // Profil hors grille: jamais comparé, mais garde l'alignement des indices
+                near_index->insert(nullptr, static_cast<uint32_t>(uniques.size()));
+            }
+            
             uniques.push_back(strat);
         }
     }
@@ -315,6 +494,12 @@ std::vector<ScoredStrategy> StrategyScorer::remove_duplicates(
     if (duplicates_count > 0) {
         std::cout << "  🔍 C++ filtre doublons: " << duplicates_count 
                   << " stratégies dupliquées éliminées (même profil P&L)" << std::endl;
+    }
+    if (near_duplicates_count > 0) {
+        std::cout << "  🔍 C++ filtre quasi-doublons: " << near_duplicates_count
+                  << " stratégies éliminées (écart P&L <= " << tolerance << ")" << std::endl;
+    }
+    if (duplicates_count > 0 || near_duplicates_count > 0) {
         std::cout << "  ✅ " << uniques.size() << " stratégies uniques conservées" << std::endl;
     }
     
@@ -322,10 +507,10 @@ std::vector<ScoredStrategy> StrategyScorer::remove_duplicates(
 }
 
 // ============================================================================
-// SCORING ET RANKING PRINCIPAL - OPTIMISÉ AVEC MIN-HEAP
+// EXTRACTION D'UNE MÉTRIQUE
 // ============================================================================
 
-static double extract_single_metric_value(const ScoredStrategy& strat, const std::string& metric_name) {
+double StrategyScorer::extract_single_metric_value(const ScoredStrategy& strat, const std::string& metric_name) {
     if (metric_name == "delta_neutral") {
         return std::abs(strat.total_delta);
     } else if (metric_name == "gamma_low") {
@@ -348,37 +533,68 @@ static double extract_single_metric_value(const ScoredStrategy& strat, const std
         return strat.delta_levrage;
     } else if (metric_name == "avg_pnl_levrage") {
         return strat.avg_pnl_levrage;
+    } else if (metric_name == "max_loss") {
+        return strat.max_loss;
+    } else if (metric_name == "max_profit") {
+        return strat.max_profit;
+    } else if (metric_name == "premium") {
+        return strat.total_premium;
+    } else if (metric_name == "profit_zone_width") {
+        return strat.profit_zone_width;
+    } else if (metric_name == "liquidity") {
+        return strat.liquidity;
     }
     return 0.0;
 }
 
-std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
-    std::vector<ScoredStrategy>& strategies,
-    std::vector<MetricConfig> metrics,
-    int top_n
+bool StrategyScorer::is_known_metric(const std::string& metric_name) {
+    static const char* const names[] = {
+        "delta_neutral", "gamma_low", "vega_low", "theta_positive", "implied_vol_moderate",
+        "average_pnl", "roll", "roll_quarterly", "sigma_pnl", "delta_levrage",
+        "avg_pnl_levrage", "max_loss", "max_profit", "premium", "profit_zone_width", "liquidity"
+    };
+    return std::find(std::begin(names), std::end(names), metric_name) != std::end(names);
+}
+
+// ============================================================================
+// SCORING PAR COLONNES
+// ============================================================================
+
+double StrategyScorer::metric_value(const ScoredStrategy& strat, const MetricConfig& metric) {
+    return metric.expression
+        ? metric.expression->evaluate_one(strat)
+        : extract_single_metric_value(strat, metric.name);
+}
+
+std::vector<std::vector<double>> StrategyScorer::extract_metric_columns(
+    const std::vector<ScoredStrategy>& strategies,
+    const std::vector<MetricConfig>& metrics
 ) {
-    if (strategies.empty()) {
-        return {};
-    }
-    
-    // Utiliser métriques par défaut si non fournies
-    if (metrics.empty()) {
-        metrics = create_default_metrics();
+    std::vector<std::vector<double>> columns(metrics.size());
+    for (size_t j = 0; j < metrics.size(); ++j) {
+        if (metrics[j].expression) {
+            columns[j] = metrics[j].expression->evaluate(strategies);
+            continue;
+        }
+        columns[j].resize(strategies.size());
+        for (size_t i = 0; i < strategies.size(); ++i) {
+            columns[j][i] = extract_single_metric_value(strategies[i], metrics[j].name);
+        }
     }
+    return columns;
+}
+
+void StrategyScorer::compute_metric_ranges(
+    const std::vector<std::vector<double>>& columns,
+    std::vector<double>& metric_mins,
+    std::vector<double>& metric_maxs
+) {
+    const size_t n_metrics = columns.size();
+    metric_mins.assign(n_metrics, std::numeric_limits<double>::max());
+    metric_maxs.assign(n_metrics, std::numeric_limits<double>::lowest());
     
-    // Normaliser les poids
-    normalize_weights(metrics);
-    
-    const size_t n_strategies = strategies.size();
-    const size_t n_metrics = metrics.size();
-    
-    // ========== ÉTAPE 1: Calculer min/max pour TOUTES les métriques en un seul passage ==========
-    std::vector<double> metric_mins(n_metrics, std::numeric_limits<double>::max());
-    std::vector<double> metric_maxs(n_metrics, std::numeric_limits<double>::lowest());
-    
-    for (const auto& strat : strategies) {
-        for (size_t j = 0; j < n_metrics; ++j) {
-            double value = extract_single_metric_value(strat, metrics[j].name);
+    for (size_t j = 0; j < n_metrics; ++j) {
+        for (double value : columns[j]) {
             if (std::isfinite(value)) {
                 metric_mins[j] = std::min(metric_mins[j], value);
                 metric_maxs[j] = std::max(metric_maxs[j], value);
@@ -396,8 +612,142 @@ std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
             metric_maxs[j] = 1.0;
         }
     }
+}
+
+std::vector<double> StrategyScorer::score_columns(
+    const std::vector<std::vector<double>>& columns,
+    const std::vector<MetricConfig>& metrics,
+    const std::vector<double>& metric_mins,
+    const std::vector<double>& metric_maxs
+) {
+    const size_t n_rows = columns.empty() ? 0 : columns[0].size();
+    std::vector<double> scores(n_rows, 0.0);
+    const int64_t n_rows_signed = static_cast<int64_t>(n_rows);
     
-    // ========== ÉTAPE 2: Scorer et maintenir top_n avec un min-heap d'INDICES ==========
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n_rows_signed; ++i) {
+        double final_score = 0.0;
+        for (size_t j = 0; j < metrics.size(); ++j) {
+            double metric_score = calculate_score(columns[j][i], metric_mins[j], metric_maxs[j], metrics[j].scorer);
+            final_score += metric_score * metrics[j].weight;
+        }
+        scores[i] = final_score;
+    }
+    return scores;
+}
+
+void StrategyScorer::apply_fixed_ranges(
+    const std::vector<MetricConfig>& metrics,
+    std::vector<double>& metric_mins,
+    std::vector<double>& metric_maxs
+) {
+    for (size_t j = 0; j < metrics.size(); ++j) {
+        if (metrics[j].normalizer == NormalizerType::FIXED) {
+            metric_mins[j] = metrics[j].fixed_min;
+            metric_maxs[j] = metrics[j].fixed_max;
+        }
+    }
+}
+
+// Demi-largeur de la fenêtre ROBUST, en IQR autour de la médiane
+static constexpr double ROBUST_IQR_SPAN = 2.0;
+
+bool StrategyScorer::is_rank_normalizer(NormalizerType normalizer) {
+    return normalizer == NormalizerType::PERCENTILE || normalizer == NormalizerType::ROBUST;
+}
+
+void StrategyScorer::apply_rank_normalizers(
+    std::vector<std::vector<double>>& columns,
+    const std::vector<MetricConfig>& metrics,
+    std::vector<double>& metric_mins,
+    std::vector<double>& metric_maxs
+) {
+    for (size_t j = 0; j < metrics.size(); ++j) {
+        const NormalizerType normalizer = metrics[j].normalizer;
+        if (!is_rank_normalizer(normalizer)) {
+            continue;
+        }
+        if (!metrics[j].quantiles) {
+            throw std::invalid_argument("normaliseur percentile/robust sans quantiles: " + metrics[j].name);
+        }
+        
+        std::vector<double>& column = columns[j];
+        const int64_t n_rows = static_cast<int64_t>(column.size());
+        const QuantileSketch& sketch = *metrics[j].quantiles;
+        
+        double lo = 0.0;
+        double span = 1.0;
+        if (normalizer == NormalizerType::ROBUST) {
+            const double median = sketch.quantile(0.5);
+            const double iqr = sketch.quantile(0.75) - sketch.quantile(0.25);
+            const double half_width = iqr > 0.0 ? ROBUST_IQR_SPAN * iqr : 0.5;
+            lo = median - half_width;
+            span = 2.0 * half_width;
+        }
+        
+        // ========== COLONNE -> POSITION DANS [0, 1] ==========
+        const bool keep_sign = metrics[j].scorer == ScorerType::POSITIVE_BETTER;
+        #pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < n_rows; ++i) {
+            const double value = column[i];
+            if (!std::isfinite(value)) {
+                continue;
+            }
+            if (keep_sign && value < 0.0) {
+                column[i] = -1.0;
+                continue;
+            }
+            column[i] = normalizer == NormalizerType::PERCENTILE
+                ? sketch.cdf(value)
+                : std::clamp((value - lo) / span, 0.0, 1.0);
+        }
+        metric_mins[j] = 0.0;
+        metric_maxs[j] = 1.0;
+    }
+}
+
+bool StrategyScorer::all_fixed(const std::vector<MetricConfig>& metrics) {
+    for (const auto& metric : metrics) {
+        if (metric.weight > 0.0 && metric.normalizer != NormalizerType::FIXED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<MetricConfig> StrategyScorer::freeze_ranges(
+    const std::vector<ScoredStrategy>& strategies,
+    std::vector<MetricConfig> metrics
+) {
+    normalize_weights(metrics);
+    std::vector<double> metric_mins;
+    std::vector<double> metric_maxs;
+    compute_metric_ranges(extract_metric_columns(strategies, metrics), metric_mins, metric_maxs);
+    apply_fixed_ranges(metrics, metric_mins, metric_maxs);
+    
+    for (size_t j = 0; j < metrics.size(); ++j) {
+        metrics[j].normalizer = NormalizerType::FIXED;
+        metrics[j].fixed_min = metric_mins[j];
+        metrics[j].fixed_max = metric_maxs[j];
+    }
+    return metrics;
+}
+
+double StrategyScorer::score_fixed(const ScoredStrategy& strat, const std::vector<MetricConfig>& metrics) {
+    double final_score = 0.0;
+    for (const auto& metric : metrics) {
+        if (metric.weight > 0.0) {
+            const double value = metric_value(strat, metric);
+            final_score += metric.weight * calculate_score(value, metric.fixed_min, metric.fixed_max, metric.scorer);
+        }
+    }
+    return final_score;
+}
+
+std::vector<size_t> StrategyScorer::select_top_indices(
+    const std::vector<double>& scores,
+    int top_n
+) {
     // Stocker (score, index) pour éviter de copier les gros objets ScoredStrategy
     using ScoreIndex = std::pair<double, size_t>;
     auto cmp = [](const ScoreIndex& a, const ScoreIndex& b) {
@@ -405,41 +755,151 @@ std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
     };
     std::priority_queue<ScoreIndex, std::vector<ScoreIndex>, decltype(cmp)> min_heap(cmp);
     
-    for (size_t idx = 0; idx < strategies.size(); ++idx) {
-        auto& strat = strategies[idx];
-        
-        // Calculer le score pour cette stratégie
-        double final_score = 0.0;
-        
-        for (size_t j = 0; j < n_metrics; ++j) {
-            double value = extract_single_metric_value(strat, metrics[j].name);
-            double min_val = metric_mins[j];
-            double max_val = metric_maxs[j];
-            
-            double metric_score = calculate_score(value, min_val, max_val, metrics[j].scorer);
-            final_score += metric_score * metrics[j].weight;
+    if (top_n <= 0) {
+        return {};
+    }
+    
+    for (size_t idx = 0; idx < scores.size(); ++idx) {
+        if (static_cast<int>(min_heap.size()) < top_n) {
+            min_heap.push({scores[idx], idx});
+        } else if (scores[idx] > min_heap.top().first) {
+            min_heap.pop();
+            min_heap.push({scores[idx], idx});
+        }
+    }
+    
+    std::vector<size_t> top_indices(min_heap.size());
+    for (size_t i = top_indices.size(); i-- > 0;) {
+        top_indices[i] = min_heap.top().second;
+        min_heap.pop();
+    }
+    return top_indices;  // Score décroissant
+}
+
+std::vector<std::vector<size_t>> StrategyScorer::select_top_indices_multi(
+    const std::vector<std::vector<double>>& columns,
+    const std::vector<MetricConfig>& metrics,
+    const std::vector<std::vector<double>>& profile_weights,
+    const std::vector<double>& metric_mins,
+    const std::vector<double>& metric_maxs,
+    int top_n
+) {
+    const size_t n_profiles = profile_weights.size();
+    const size_t n_metrics = metrics.size();
+    const size_t n_rows = columns.empty() ? 0 : columns[0].size();
+    if (top_n <= 0 || n_profiles == 0) {
+        return std::vector<std::vector<size_t>>(n_profiles);
+    }
+    
+    // Ordre total (score décroissant, index croissant): résultat indépendant du découpage
+    using ScoreIndex = std::pair<double, size_t>;
+    auto better = [](const ScoreIndex& a, const ScoreIndex& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    using Heap = std::priority_queue<ScoreIndex, std::vector<ScoreIndex>, decltype(better)>;
+    auto offer = [top_n, &better](Heap& heap, const ScoreIndex& item) {
+        if (static_cast<int>(heap.size()) < top_n) {
+            heap.push(item);
+        } else if (better(item, heap.top())) {
+            heap.pop();
+            heap.push(item);
         }
+    };
+    
+    std::vector<Heap> heaps(n_profiles, Heap(better));
+    const int64_t n_rows_signed = static_cast<int64_t>(n_rows);
+    
+    #pragma omp parallel
+    {
+        std::vector<Heap> local_heaps(n_profiles, Heap(better));
+        std::vector<double> sub_scores(n_metrics);
         
-        strat.score = final_score;
+        #pragma omp for schedule(static) nowait
+        for (int64_t i = 0; i < n_rows_signed; ++i) {
+            for (size_t j = 0; j < n_metrics; ++j) {
+                sub_scores[j] = calculate_score(columns[j][i], metric_mins[j], metric_maxs[j], metrics[j].scorer);
+            }
+            for (size_t p = 0; p < n_profiles; ++p) {
+                double score = 0.0;
+                for (size_t j = 0; j < n_metrics; ++j) {
+                    score += sub_scores[j] * profile_weights[p][j];
+                }
+                offer(local_heaps[p], {score, static_cast<size_t>(i)});
+            }
+        }
         
-        // Ajouter l'index au heap (pas l'objet complet!)
-        if (static_cast<int>(min_heap.size()) < top_n) {
-            min_heap.push({final_score, idx});
-        } else if (final_score > min_heap.top().first) {
-            min_heap.pop();
-            min_heap.push({final_score, idx});
+        #pragma omp critical
+        {
+            for (size_t p = 0; p < n_profiles; ++p) {
+                while (!local_heaps[p].empty()) {
+                    offer(heaps[p], local_heaps[p].top());
+                    local_heaps[p].pop();
+                }
+            }
         }
     }
     
-    // ========== ÉTAPE 3: Extraire les indices et construire le résultat ==========
-    std::vector<size_t> top_indices;
-    top_indices.reserve(min_heap.size());
+    std::vector<std::vector<size_t>> top_indices(n_profiles);
+    for (size_t p = 0; p < n_profiles; ++p) {
+        top_indices[p].resize(heaps[p].size());
+        for (size_t i = top_indices[p].size(); i-- > 0;) {
+            top_indices[p][i] = heaps[p].top().second;
+            heaps[p].pop();
+        }
+    }
+    return top_indices;
+}
+
+// ============================================================================
+// SCORING ET RANKING PRINCIPAL
+// ============================================================================
+
+std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
+    std::vector<ScoredStrategy>& strategies,
+    std::vector<MetricConfig> metrics,
+    int top_n,
+    const SelectionConfig& selection
+) {
+    if (strategies.empty()) {
+        return {};
+    }
     
-    while (!min_heap.empty()) {
-        top_indices.push_back(min_heap.top().second);
-        min_heap.pop();
+    // Utiliser métriques par défaut si non fournies
+    if (metrics.empty()) {
+        metrics = create_default_metrics();
     }
     
+    // Normaliser les poids
+    normalize_weights(metrics);
+    
+    // ========== ÉTAPE 1: Extraire les colonnes et leurs min/max en un seul passage ==========
+    auto columns = extract_metric_columns(strategies, metrics);
+    std::vector<double> metric_mins, metric_maxs;
+    compute_metric_ranges(columns, metric_mins, metric_maxs);
+    apply_fixed_ranges(metrics, metric_mins, metric_maxs);
+    apply_rank_normalizers(columns, metrics, metric_mins, metric_maxs);
+    
+    // ========== ÉTAPE 2: Scorer toutes les stratégies ==========
+    const std::vector<double> scores = score_columns(columns, metrics, metric_mins, metric_maxs);
+    for (size_t idx = 0; idx < strategies.size(); ++idx) {
+        strategies[idx].score = scores[idx];
+    }
+    
+    if (selection.mode == SelectionMode::PARETO) {
+        // Les fronts portent sur toutes les stratégies
+        return pareto_fronts(strategies, selection.objectives, selection.pareto_fronts, top_n);
+    }
+    
+    if (selection.mode == SelectionMode::GROUPED) {
+        return select_grouped(strategies, scores, top_n, selection.group_key);
+    }
+    
+    // ========== ÉTAPE 3: Top via min-heap d'INDICES ==========
+    // Le mode MMR re-sélectionne parmi un pool borné des meilleurs scores
+    const bool use_mmr = selection.mode == SelectionMode::MMR;
+    const int heap_size = use_mmr ? top_n * std::max(selection.mmr_pool_factor, 1) : top_n;
+    const std::vector<size_t> top_indices = select_top_indices(scores, heap_size);
+    
     // Construire le résultat en utilisant std::move pour éviter les copies
     std::vector<ScoredStrategy> result;
     result.reserve(top_indices.size());
@@ -448,11 +908,9 @@ std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
         result.push_back(std::move(strategies[idx]));
     }
     
-    std::sort(result.begin(), result.end(),
-        [](const ScoredStrategy& a, const ScoredStrategy& b) {
-            return a.score > b.score;
-        }
-    );
+    if (use_mmr) {
+        result = select_mmr(result, top_n, selection);
+    }
     
     // Assigner les rangs
     for (size_t i = 0; i < result.size(); ++i) {
@@ -462,4 +920,428 @@ std::vector<ScoredStrategy> StrategyScorer::score_and_rank(
     return result;
 }
 
+// ============================================================================
+// SÉLECTION DIVERSIFIÉE - MAXIMAL MARGINAL RELEVANCE
+// ============================================================================
+
+// Similarité P&L dans [0, 1]: 1 - |a - b| / (|a| + |b|) (inégalité triangulaire)
+static double pnl_similarity(
+    const std::vector<double>& a,
+    const std::vector<double>& b,
+    double norm_a,
+    double norm_b
+) {
+    if (a.size() != b.size()) {
+        return 0.0;
+    }
+    const double denom = norm_a + norm_b;
+    if (denom <= 0.0) {
+        return 1.0;
+    }
+    double sq = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const double d = a[i] - b[i];
+        sq += d * d;
+    }
+    return 1.0 - std::sqrt(sq) / denom;
+}
+
+// Similarité de Jaccard entre multi-ensembles de jambes (option, signe)
+static double legs_similarity(const ScoredStrategy& a, const ScoredStrategy& b) {
+    std::vector<std::pair<int, int>> legs_a, legs_b;
+    for (size_t i = 0; i < a.option_indices.size(); ++i) {
+        legs_a.emplace_back(a.option_indices[i], a.signs[i]);
+    }
+    for (size_t i = 0; i < b.option_indices.size(); ++i) {
+        legs_b.emplace_back(b.option_indices[i], b.signs[i]);
+    }
+    std::sort(legs_a.begin(), legs_a.end());
+    std::sort(legs_b.begin(), legs_b.end());
+    
+    std::vector<std::pair<int, int>> common;
+    std::set_intersection(legs_a.begin(), legs_a.end(), legs_b.begin(), legs_b.end(),
+                          std::back_inserter(common));
+    const size_t n_union = legs_a.size() + legs_b.size() - common.size();
+    return n_union > 0 ? static_cast<double>(common.size()) / n_union : 1.0;
+}
+
+std::vector<ScoredStrategy> StrategyScorer::select_mmr(
+    std::vector<ScoredStrategy>& pool,
+    int top_n,
+    const SelectionConfig& selection
+) {
+    const size_t n = pool.size();
+    const size_t n_select = std::min(n, static_cast<size_t>(std::max(top_n, 0)));
+    const double lambda = std::clamp(selection.mmr_lambda, 0.0, 1.0);
+    const bool by_pnl = selection.diversity == DiversityMetric::PNL;
+    
+    std::vector<double> norms(n, 0.0);
+    if (by_pnl) {
+        for (size_t i = 0; i < n; ++i) {
+            double sq = 0.0;
+            for (double v : pool[i].total_pnl_array) sq += v * v;
+            norms[i] = std::sqrt(sq);
+        }
+    }
+    
+    auto similarity = [&](size_t i, size_t j) {
+        return by_pnl
+            ? pnl_similarity(pool[i].total_pnl_array, pool[j].total_pnl_array, norms[i], norms[j])
+            : legs_similarity(pool[i], pool[j]);
+    };
+    
+    // Cache par candidat: sim_max et nombre de sélectionnés déjà pris en compte
+    std::vector<double> max_sim(n, 0.0);
+    std::vector<size_t> seen_upto(n, 0);
+    std::vector<size_t> selected;
+    selected.reserve(n_select);
+    
+    // Max-heap de (valeur MMR en cache, indice): bornes supérieures paresseuses
+    using MmrEntry = std::pair<double, size_t>;
+    std::priority_queue<MmrEntry> heap;
+    for (size_t i = 0; i < n; ++i) {
+        heap.push({lambda * pool[i].score, i});
+    }
+    
+    while (selected.size() < n_select && !heap.empty()) {
+        const size_t i = heap.top().second;
+        heap.pop();
+        
+        if (seen_upto[i] < selected.size()) {
+            for (size_t k = seen_upto[i]; k < selected.size(); ++k) {
+                max_sim[i] = std::max(max_sim[i], similarity(i, selected[k]));
+            }
+            seen_upto[i] = selected.size();
+            heap.push({lambda * pool[i].score - (1.0 - lambda) * max_sim[i], i});
+            continue;
+        }
+        
+        selected.push_back(i);
+    }
+    
+    std::vector<ScoredStrategy> result;
+    result.reserve(selected.size());
+    for (size_t i : selected) {
+        result.push_back(std::move(pool[i]));
+    }
+    return result;
+}
+
+// ============================================================================
+// FRONTS DE PARETO - SORT-FILTER-SKYLINE PARALLÈLE
+// ============================================================================
+
+// a domine b: au moins aussi bon partout et strictement meilleur une fois
+// (objectifs orientés: plus grand = meilleur)
+static bool dominates(const double* a, const double* b, size_t m) {
+    bool strictly_better = false;
+    for (size_t k = 0; k < m; ++k) {
+        if (a[k] < b[k]) return false;
+        if (a[k] > b[k]) strictly_better = true;
+    }
+    return strictly_better;
+}
+
+static bool dominated_by_any(
+    const double* candidate,
+    const size_t* window,
+    size_t count,
+    const std::vector<double>& objectives,
+    size_t m
+) {
+    for (size_t w = 0; w < count; ++w) {
+        if (dominates(&objectives[window[w] * m], candidate, m)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Skyline d'une séquence triée par clé monotone décroissante: un point ne peut
+// être dominé que par un point qui le précède, donc le front ne fait que croître.
+// Par blocs: chaque point est testé en parallèle contre le front courant (lecture
+// seule), puis les rares survivants sont départagés séquentiellement entre eux.
+static std::vector<size_t> sfs_skyline(
+    const std::vector<size_t>& ids,
+    const std::vector<double>& objectives,
+    size_t m
+) {
+    constexpr size_t BLOCK_SIZE = 8192;
+    std::vector<size_t> window;
+    std::vector<char> dominated;
+    
+    for (size_t begin = 0; begin < ids.size(); begin += BLOCK_SIZE) {
+        const size_t count = std::min(BLOCK_SIZE, ids.size() - begin);
+        const size_t window_before = window.size();
+        dominated.assign(count, 0);
+        
+        const int64_t count_signed = static_cast<int64_t>(count);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int64_t i = 0; i < count_signed; ++i) {
+            dominated[i] = dominated_by_any(
+                &objectives[ids[begin + i] * m], window.data(), window_before, objectives, m);
+        }
+        
+        for (size_t i = 0; i < count; ++i) {
+            if (dominated[i]) continue;
+            const size_t id = ids[begin + i];
+            if (!dominated_by_any(&objectives[id * m], window.data() + window_before,
+                                  window.size() - window_before, objectives, m)) {
+                window.push_back(id);
+            }
+        }
+    }
+    return window;
+}
+
+std::vector<ScoredStrategy> StrategyScorer::pareto_fronts(
+    std::vector<ScoredStrategy>& strategies,
+    std::vector<ObjectiveConfig> objectives,
+    int n_fronts,
+    int max_results
+) {
+    if (strategies.empty() || n_fronts <= 0) {
+        return {};
+    }
+    if (objectives.empty()) {
+        objectives = create_default_objectives();
+    }
+    
+    const size_t n = strategies.size();
+    const size_t m = objectives.size();
+    
+    // Matrice n x m des objectifs orientés (valeurs non finies = pires)
+    std::vector<double> values(n * m);
+    std::vector<double> obj_mins(m, std::numeric_limits<double>::max());
+    std::vector<double> obj_maxs(m, std::numeric_limits<double>::lowest());
+    
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < m; ++k) {
+            double v = extract_single_metric_value(strategies[i], objectives[k].name);
+            if (!std::isfinite(v)) {
+                values[i * m + k] = std::numeric_limits<double>::lowest();
+                continue;
+            }
+            v = objectives[k].maximize ? v : -v;
+            values[i * m + k] = v;
+            obj_mins[k] = std::min(obj_mins[k], v);
+            obj_maxs[k] = std::max(obj_maxs[k], v);
+        }
+    }
+    
+    // Clé monotone: somme des objectifs normalisés (dominer => clé >= )
+    std::vector<double> keys(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < m; ++k) {
+            const double range = obj_maxs[k] - obj_mins[k];
+            const double v = values[i * m + k];
+            if (range > 0.0 && v != std::numeric_limits<double>::lowest()) {
+                keys[i] += (v - obj_mins[k]) / range;
+            } else if (v == std::numeric_limits<double>::lowest()) {
+                keys[i] -= 1.0;
+            }
+        }
+    }
+    
+    // Égalité de clé départagée lexicographiquement: un dominant précède toujours
+    std::vector<size_t> remaining(n);
+    std::iota(remaining.begin(), remaining.end(), 0);
+    std::sort(remaining.begin(), remaining.end(), [&](size_t a, size_t b) {
+        if (keys[a] != keys[b]) return keys[a] > keys[b];
+        return std::lexicographical_compare(
+            &values[b * m], &values[b * m] + m, &values[a * m], &values[a * m] + m);
+    });
+    
+    std::vector<int> front_of(n, 0);
+    std::vector<size_t> ordered;
+    
+    for (int front = 1; front <= n_fronts && !remaining.empty(); ++front) {
+        std::vector<size_t> skyline = sfs_skyline(remaining, values, m);
+        
+        for (size_t id : skyline) {
+            front_of[id] = front;
+        }
+        
+        // Meilleur score d'abord au sein d'un front
+        std::stable_sort(skyline.begin(), skyline.end(), [&](size_t a, size_t b) {
+            return strategies[a].score > strategies[b].score;
+        });
+        ordered.insert(ordered.end(), skyline.begin(), skyline.end());
+        
+        remaining.erase(
+            std::remove_if(remaining.begin(), remaining.end(),
+                           [&](size_t id) { return front_of[id] != 0; }),
+            remaining.end());
+        
+        if (max_results > 0 && ordered.size() >= static_cast<size_t>(max_results)) {
+            break;
+        }
+    }
+    
+    if (max_results > 0 && ordered.size() > static_cast<size_t>(max_results)) {
+        ordered.resize(max_results);
+    }
+    
+    std::vector<ScoredStrategy> result;
+    result.reserve(ordered.size());
+    for (size_t i = 0; i < ordered.size(); ++i) {
+        ScoredStrategy strat = std::move(strategies[ordered[i]]);
+        strat.pareto_front = front_of[ordered[i]];
+        strat.rank = static_cast<int>(i + 1);
+        result.push_back(std::move(strat));
+    }
+    
+    std::cout << "  📐 Pareto: " << result.size() << " stratégies sur "
+              << (result.empty() ? 0 : result.back().pareto_front) << " front(s)" << std::endl;
+    
+    return result;
+}
+
+// ============================================================================
+// SÉLECTION PAR GROUPE
+// ============================================================================
+
+int StrategyScorer::group_of(const ScoredStrategy& strat, GroupKey key) {
+    switch (key) {
+        case GroupKey::N_LEGS:
+            return static_cast<int>(strat.option_indices.size());
+        case GroupKey::CALL_PUT:
+            return strat.call_legs * 100 + strat.put_legs;
+        case GroupKey::STRUCTURE:
+            return static_cast<int>(strat.structure);
+        case GroupKey::EXPIRY:
+            return strat.expiry_set;
+    }
+    return 0;
+}
+
+std::string StrategyScorer::group_label(int group, GroupKey key) {
+    switch (key) {
+        case GroupKey::N_LEGS:
+            return std::to_string(group) + "_legs";
+        case GroupKey::CALL_PUT:
+            return std::to_string(group / 100) + "C" + std::to_string(group % 100) + "P";
+        case GroupKey::STRUCTURE:
+            switch (static_cast<StructureClass>(group)) {
+                case StructureClass::SINGLE:         return "single";
+                case StructureClass::VERTICAL:       return "vertical";
+                case StructureClass::RATIO_SPREAD:   return "ratio_spread";
+                case StructureClass::STRADDLE:       return "straddle";
+                case StructureClass::STRANGLE:       return "strangle";
+                case StructureClass::RISK_REVERSAL:  return "risk_reversal";
+                case StructureClass::BUTTERFLY:      return "butterfly";
+                case StructureClass::CONDOR:         return "condor";
+                case StructureClass::IRON_BUTTERFLY: return "iron_butterfly";
+                case StructureClass::IRON_CONDOR:    return "iron_condor";
+                case StructureClass::CALENDAR:       return "calendar";
+                case StructureClass::OTHER:          return "other";
+            }
+            break;
+        case GroupKey::EXPIRY: {
+            // Rangs d'échéance croissants: "E0", "E0+E2", ...
+            std::string label;
+            for (int rank = 0; rank <= 30; ++rank) {
+                if (group & (1 << rank)) {
+                    label += (label.empty() ? "E" : "+E") + std::to_string(rank);
+                }
+            }
+            return label;
+        }
+    }
+    return "other";
+}
+
+std::vector<ScoredStrategy> StrategyScorer::select_grouped(
+    std::vector<ScoredStrategy>& strategies,
+    const std::vector<double>& scores,
+    int top_n,
+    GroupKey key
+) {
+    if (top_n <= 0) {
+        return {};
+    }
+    
+    // Min-heap (score, index) borné par groupe, groupes triés par identifiant
+    using ScoreIndex = std::pair<double, size_t>;
+    auto better = [](const ScoreIndex& a, const ScoreIndex& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    using Heap = std::priority_queue<ScoreIndex, std::vector<ScoreIndex>, decltype(better)>;
+    std::map<int, Heap> heaps;
+    
+    for (size_t idx = 0; idx < strategies.size(); ++idx) {
+        const int group = group_of(strategies[idx], key);
+        auto it = heaps.find(group);
+        if (it == heaps.end()) {
+            it = heaps.emplace(group, Heap(better)).first;
+        }
+        Heap& heap = it->second;
+        const ScoreIndex item{scores[idx], idx};
+        if (static_cast<int>(heap.size()) < top_n) {
+            heap.push(item);
+        } else if (better(item, heap.top())) {
+            heap.pop();
+            heap.push(item);
+        }
+    }
+    
+    std::vector<ScoredStrategy> result;
+    for (auto& [group, heap] : heaps) {
+        std::vector<size_t> indices(heap.size());
+        for (size_t i = indices.size(); i-- > 0;) {
+            indices[i] = heap.top().second;
+            heap.pop();
+        }
+        for (size_t i = 0; i < indices.size(); ++i) {
+            ScoredStrategy& strat = strategies[indices[i]];
+            strat.group = group;
+            strat.rank = static_cast<int>(i + 1);
+            result.push_back(std::move(strat));
+        }
+    }
+    
+    std::cout << "Sélection par groupe: " << heaps.size() << " groupes, "
+              << result.size() << " stratégies" << std::endl;
+    return result;
+}
+
+// ============================================================================
+// HEAP BORNÉ (SCORING EN UN PASSAGE)
+// ============================================================================
+
+static bool higher_score(const ScoredStrategy& a, const ScoredStrategy& b) {
+    return a.score > b.score;  // Min-heap: plus petit score en haut
+}
+
+bool TopStrategyHeap::accepts(double score) const {
+    return capacity_ > 0 && (items_.size() < capacity_ || score > items_.front().score);
+}
+
+void TopStrategyHeap::push(ScoredStrategy&& strat) {
+    if (!accepts(strat.score)) {
+        return;
+    }
+    if (items_.size() == capacity_) {
+        std::pop_heap(items_.begin(), items_.end(), higher_score);
+        items_.back() = std::move(strat);
+    } else {
+        items_.push_back(std::move(strat));
+    }
+    std::push_heap(items_.begin(), items_.end(), higher_score);
+}
+
+void TopStrategyHeap::merge(TopStrategyHeap&& other) {
+    for (auto& strat : other.items_) {
+        push(std::move(strat));
+    }
+    other.items_.clear();
+}
+
+std::vector<ScoredStrategy> TopStrategyHeap::take_sorted() {
+    std::sort_heap(items_.begin(), items_.end(), higher_score);
+    std::vector<ScoredStrategy> result = std::move(items_);
+    items_.clear();
+    return result;
+}
+
 } // namespace strategy
@@ -5,11 +5,15 @@
 
 #pragma once
 
+#include "strategy_expression.hpp"
+#include "strategy_sketch.hpp"
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <cstdint>
+#include <memory>
 
 namespace strategy {
 
@@ -27,7 +31,59 @@ enum class ScorerType {
 enum class NormalizerType {
     MAX,                // Normalisation par maximum
     MIN_MAX,           // Normalisation min-max
-    COUNT              // Normalisation pour compteurs
+    COUNT,             // Normalisation pour compteurs
+    FIXED,             // Bornes [fixed_min, fixed_max] fournies: score final dès l'évaluation
+    PERCENTILE,        // Rang (cdf) de la valeur dans l'ensemble valide, via sketch de quantiles
+    ROBUST             // Médiane +/- 2 IQR (quantiles du sketch): insensible aux valeurs extrêmes
+};
+
+enum class DedupMode {
+    EXACT,              // Même payoff (empreinte canonique)
+    NEAR_LINF,          // Quasi-doublons: max |écart P&L| <= tolérance
+    NEAR_L2             // Quasi-doublons: écart P&L quadratique moyen <= tolérance
+};
+
+enum class SelectionMode {
+    TOP_N,              // Les top_n meilleurs scores
+    MMR,                // Maximal marginal relevance: score vs diversité
+    PARETO,             // Fronts non dominés sur plusieurs objectifs
+    GROUPED             // Les top_n meilleurs scores de chaque groupe
+};
+
+enum class GroupKey {
+    N_LEGS,             // Nombre de jambes
+    CALL_PUT,           // Nombre de calls et de puts
+    STRUCTURE,          // Classe structurelle (StructureClass)
+    EXPIRY              // Ensemble des échéances des jambes
+};
+
+enum class DiversityMetric {
+    PNL,                // Distance entre profils P&L
+    LEGS                // Distance de Jaccard entre jambes (option, signe)
+};
+
+/**
+ * Objectif du mode Pareto (nom de métrique de extract_single_metric_value)
+ */
+struct ObjectiveConfig {
+    std::string name;
+    bool maximize;
+    
+    ObjectiveConfig(const std::string& n, bool max)
+        : name(n), maximize(max) {}
+};
+
+/**
+ * Configuration de la sélection finale des stratégies
+ */
+struct SelectionConfig {
+    SelectionMode mode = SelectionMode::TOP_N;
+    double mmr_lambda = 0.7;        // 1 = score pur, 0 = diversité pure
+    DiversityMetric diversity = DiversityMetric::PNL;
+    int mmr_pool_factor = 5;        // Pool MMR borné à top_n * mmr_pool_factor
+    int pareto_fronts = 1;          // Nombre de fronts successifs retournés
+    GroupKey group_key = GroupKey::N_LEGS;  // Mode GROUPED: top_n par groupe
+    std::vector<ObjectiveConfig> objectives;  // Vide = create_default_objectives()
 };
 
 /**
@@ -38,6 +94,15 @@ struct MetricConfig {
     double weight;
     NormalizerType normalizer;
     ScorerType scorer;
+    double fixed_min = 0.0;     // Bornes du normaliseur FIXED (calibrées par l'utilisateur)
+    double fixed_max = 0.0;
+    
+    // Métrique personnalisée compilée (nullptr = métrique connue par son nom)
+    std::shared_ptr<const MetricExpression> expression;
+    
+    // PERCENTILE / ROBUST: quantiles de l'ensemble valide (sketch fusionné, préparé),
+    // alimentés pendant l'énumération
+    std::shared_ptr<const QuantileSketch> quantiles;
     
     MetricConfig(const std::string& n, double w, NormalizerType norm, ScorerType sc)
         : name(n), weight(w), normalizer(norm), scorer(sc) {}
@@ -69,13 +134,21 @@ struct ScoredStrategy {
     double profit_zone_width;
     double delta_levrage;
     double avg_pnl_levrage;
+    double liquidity;       // Plus petit open interest des jambes
     int call_count;
     int put_count;
+    int call_legs;
+    int put_legs;
+    StructureClass structure;
+    int expiry_set;     // Échéances des jambes (voir StrategyMetrics::expiry_set)
     std::vector<double> breakeven_points;
     
     // P&L array pour la stratégie complète
     std::vector<double> total_pnl_array;
     
+    // Empreinte canonique du payoff (0 = non calculée, voir payoff_fingerprint)
+    uint64_t payoff_key;
+    
     // Indices des options et signes
     std::vector<int> option_indices;
     std::vector<int> signs;
@@ -83,6 +156,8 @@ struct ScoredStrategy {
     // Score et rang
     double score;
     int rank;
+    int pareto_front;   // 1 = non dominé (mode PARETO), 0 sinon
+    int group;          // Identifiant de groupe (mode GROUPED), -1 sinon
     
     ScoredStrategy() 
         : total_premium(0), total_delta(0), total_gamma(0), total_vega(0),
@@ -90,8 +165,32 @@ struct ScoredStrategy {
           roll(0), roll_quarterly(0), roll_sum(0), sigma_pnl(0),
           max_profit(0), max_loss(0), max_loss_left(0), max_loss_right(0),
           min_profit_price(0), max_profit_price(0), profit_zone_width(0),
-          delta_levrage(0), avg_pnl_levrage(0),
-          call_count(0), put_count(0), score(0), rank(0) {}
+          delta_levrage(0), avg_pnl_levrage(0), liquidity(0),
+          call_count(0), put_count(0), call_legs(0), put_legs(0),
+          structure(StructureClass::OTHER), expiry_set(0), payoff_key(0), score(0), rank(0),
+          pareto_front(0), group(-1) {}
+};
+
+/**
+ * Heap borné des meilleures stratégies, pour un score final connu dès
+ * l'évaluation (normaliseurs FIXED): aucun stockage des candidats
+ */
+class TopStrategyHeap {
+public:
+    explicit TopStrategyHeap(size_t capacity) : capacity_(capacity) {}
+    
+    // Le score entrerait-il dans le heap ? (avant de construire la stratégie)
+    bool accepts(double score) const;
+    void push(ScoredStrategy&& strat);
+    void merge(TopStrategyHeap&& other);
+    
+    // Vide le heap, par score décroissant
+    std::vector<ScoredStrategy> take_sorted();
+    size_t size() const { return items_.size(); }
+
+private:
+    size_t capacity_;
+    std::vector<ScoredStrategy> items_;  // Min-heap sur le score
 };
 
 // ============================================================================
@@ -102,6 +201,12 @@ class StrategyScorer {
 public:
     static std::vector<MetricConfig> create_default_metrics();
     
+    /**
+     * Objectifs Pareto par défaut: average_pnl max, sigma_pnl min,
+     * max_loss max (perte la moins forte), premium min
+     */
+    static std::vector<ObjectiveConfig> create_default_objectives();
+    
     static void normalize_weights(std::vector<MetricConfig>& metrics);
 
     static std::vector<double> extract_metric_values(
@@ -109,6 +214,126 @@ public:
         const std::string& metric_name
     );
     
+    /**
+     * Valeur brute d'une métrique (nom de scoring ou champ) pour une stratégie
+     */
+    static double extract_single_metric_value(
+        const ScoredStrategy& strat,
+        const std::string& metric_name
+    );
+    
+    /**
+     * Vrai si extract_single_metric_value connaît metric_name
+     */
+    static bool is_known_metric(const std::string& metric_name);
+    
+    /**
+     * Valeur brute d'une métrique, personnalisée (expression) ou par son nom
+     */
+    static double metric_value(const ScoredStrategy& strat, const MetricConfig& metric);
+    
+    /**
+     * Une colonne de valeurs brutes par métrique (valeurs non finies conservées);
+     * les expressions sont évaluées par blocs de lignes
+     */
+    static std::vector<std::vector<double>> extract_metric_columns(
+        const std::vector<ScoredStrategy>& strategies,
+        const std::vector<MetricConfig>& metrics
+    );
+    
+    /**
+     * min/max des valeurs finies de chaque colonne (corrigés si min == max)
+     */
+    static void compute_metric_ranges(
+        const std::vector<std::vector<double>>& columns,
+        std::vector<double>& metric_mins,
+        std::vector<double>& metric_maxs
+    );
+    
+    /**
+     * Score pondéré de chaque ligne (poids déjà normalisés)
+     */
+    static std::vector<double> score_columns(
+        const std::vector<std::vector<double>>& columns,
+        const std::vector<MetricConfig>& metrics,
+        const std::vector<double>& metric_mins,
+        const std::vector<double>& metric_maxs
+    );
+    
+    /**
+     * Remplace les min/max observés par les bornes des métriques FIXED
+     */
+    static void apply_fixed_ranges(
+        const std::vector<MetricConfig>& metrics,
+        std::vector<double>& metric_mins,
+        std::vector<double>& metric_maxs
+    );
+    
+    /**
+     * PERCENTILE ou ROBUST: bornes tirées des quantiles de l'ensemble valide
+     */
+    static bool is_rank_normalizer(NormalizerType normalizer);
+    
+    /**
+     * Normaliseurs PERCENTILE / ROBUST: chaque colonne concernée est remplacée
+     * en place par sa position t dans [0, 1] (croissante avec la valeur) selon
+     * les quantiles de MetricConfig::quantiles, et ses bornes par [0, 1]. Les
+     * scorers s'appliquent ensuite à t; POSITIVE_BETTER garde 0 pour les
+     * valeurs < 0. Lève std::invalid_argument si les quantiles manquent.
+     */
+    static void apply_rank_normalizers(
+        std::vector<std::vector<double>>& columns,
+        const std::vector<MetricConfig>& metrics,
+        std::vector<double>& metric_mins,
+        std::vector<double>& metric_maxs
+    );
+    
+    /**
+     * Copie des métriques (poids normalisés) aux bornes figées en FIXED sur les
+     * min/max observés dans strategies (bornes FIXED existantes conservées):
+     * score_fixed donne alors le score de la stratégie dans cet ensemble.
+     * Les normaliseurs de rang sont approchés par leurs min/max.
+     */
+    static std::vector<MetricConfig> freeze_ranges(
+        const std::vector<ScoredStrategy>& strategies,
+        std::vector<MetricConfig> metrics
+    );
+    
+    /**
+     * Toutes les métriques de poids non nul ont-elles des bornes FIXED ?
+     */
+    static bool all_fixed(const std::vector<MetricConfig>& metrics);
+    
+    /**
+     * Score final d'une stratégie seule (métriques FIXED, poids normalisés)
+     */
+    static double score_fixed(const ScoredStrategy& strat, const std::vector<MetricConfig>& metrics);
+    
+    /**
+     * Indices des top_n meilleurs scores (min-heap), par score décroissant
+     */
+    static std::vector<size_t> select_top_indices(
+        const std::vector<double>& scores,
+        int top_n
+    );
+    
+    /**
+     * Top_n de plusieurs profils de poids en un seul passage: sous-scores
+     * calculés une fois par ligne, un produit scalaire et un heap par profil
+     *
+     * @param metrics Métriques (scorers) communes aux profils
+     * @param profile_weights Poids normalisés, un vecteur (n_metrics) par profil
+     * @return Indices par profil, par score décroissant
+     */
+    static std::vector<std::vector<size_t>> select_top_indices_multi(
+        const std::vector<std::vector<double>>& columns,
+        const std::vector<MetricConfig>& metrics,
+        const std::vector<std::vector<double>>& profile_weights,
+        const std::vector<double>& metric_mins,
+        const std::vector<double>& metric_maxs,
+        int top_n
+    );
+    
     static std::pair<double, double> normalize_values(
         const std::vector<double>& values,
         NormalizerType normalizer
@@ -121,31 +346,88 @@ public:
         ScorerType scorer
     );
     
-    /**
-     * Vérifie si deux P&L arrays sont identiques (avec tolérance)
-     */
-    static bool are_pnl_equal(
-        const std::vector<double>& pnl1,
-        const std::vector<double>& pnl2,
-        int decimals = 4
-    );
-    
     /**
      * Filtre les stratégies doublons (même profil P&L)
+     * Utilise payoff_key quand elle est renseignée (O(1) par stratégie),
+     * sinon un hash 64 bits du P&L array complet arrondi à decimals.
+     *
+     * En mode NEAR_LINF / NEAR_L2, les profils à moins de tolerance d'une
+     * stratégie déjà retenue sont aussi éliminés. Les candidats sont trouvés
+     * par LSH (tables de hachage multiples), puis la distance est vérifiée
+     * exactement: coût linéaire, pas de comparaison par paires.
+     *
+     * @param weights Pondération des points de la grille (ex: mixture), vide = uniforme
      */
     static std::vector<ScoredStrategy> remove_duplicates(
         const std::vector<ScoredStrategy>& strategies,
         int decimals = 4,
-        int max_unique = 0
+        int max_unique = 0,
+        DedupMode mode = DedupMode::EXACT,
+        double tolerance = 0.0,
+        const std::vector<double>& weights = {}
     );
     
     /**
      * Score et classe les stratégies selon les métriques configurées
+     * En mode MMR, un pool borné des meilleurs scores est re-sélectionné
+     * par select_mmr pour diversifier le top_n. En mode PARETO, toutes les
+     * stratégies sont scorées puis réduites à leurs fronts non dominés.
+     * En mode GROUPED, top_n s'applique à chaque groupe (selection.group_key).
      */
     static std::vector<ScoredStrategy> score_and_rank(
         std::vector<ScoredStrategy>& strategies,
         std::vector<MetricConfig> metrics = {},
-        int top_n = 10
+        int top_n = 10,
+        const SelectionConfig& selection = SelectionConfig()
+    );
+    
+    /**
+     * Extrait les n_fronts premiers fronts de Pareto (sort-filter-skyline).
+     * Les candidats sont triés par une clé monotone (somme des objectifs
+     * normalisés), donc un point n'est comparé qu'au front en construction,
+     * jamais à tous les autres. Les tests de dominance sont faits par blocs
+     * en parallèle.
+     *
+     * @return Stratégies triées par front puis par score, max_results au plus
+     */
+    static std::vector<ScoredStrategy> pareto_fronts(
+        std::vector<ScoredStrategy>& strategies,
+        std::vector<ObjectiveConfig> objectives,
+        int n_fronts,
+        int max_results
+    );
+    
+    /**
+     * Top_n de chaque groupe en un passage (un heap borné par groupe).
+     * Résultat trié par groupe puis par score; rank = rang dans le groupe.
+     */
+    static std::vector<ScoredStrategy> select_grouped(
+        std::vector<ScoredStrategy>& strategies,
+        const std::vector<double>& scores,
+        int top_n,
+        GroupKey key
+    );
+    
+    /**
+     * Identifiant de groupe d'une stratégie, et son libellé
+     */
+    static int group_of(const ScoredStrategy& strat, GroupKey key);
+    static std::string group_label(int group, GroupKey key);
+    
+    /**
+     * Sélection gloutonne MMR: maximise lambda * score - (1 - lambda) * sim_max,
+     * sim_max étant la similarité au plus proche déjà sélectionné (dans [0, 1]).
+     * Évaluation paresseuse: sim_max ne fait que croître, donc la valeur MMR
+     * en cache est une borne supérieure et n'est mise à jour que contre les
+     * stratégies sélectionnées depuis sa dernière évaluation.
+     *
+     * @param pool Candidats (déplacés dans le résultat)
+     * @return Stratégies dans l'ordre de sélection
+     */
+    static std::vector<ScoredStrategy> select_mmr(
+        std::vector<ScoredStrategy>& pool,
+        int top_n,
+        const SelectionConfig& selection
     );
 };
 
@@ -0,0 +1,386 @@
+/**
+ * Implémentation du store de session
+ */
+
+#include "strategy_session.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace strategy {
+
+// ============================================================================
+// JOURNAL DES REJETS
+// ============================================================================
+
+void RejectionLog::task_legs(size_t task, std::vector<int>& indices, std::vector<int>& signs) const {
+    const size_t combo = task >> n_legs;
+    const size_t mask = task & ((size_t(1) << n_legs) - 1);
+    indices.assign(combos.begin() + combo * n_legs, combos.begin() + (combo + 1) * n_legs);
+    signs.resize(n_legs);
+    for (int i = 0; i < n_legs; ++i) {
+        signs[i] = (mask & (size_t(1) << i)) ? 1 : -1;
+    }
+}
+
+size_t RejectionLog::find_task(const std::vector<int>& indices, const std::vector<int>& signs) const {
+    if (static_cast<int>(indices.size()) != n_legs || n_legs == 0) {
+        return npos;
+    }
+    
+    // Combinaisons triées lexicographiquement (next_combination)
+    size_t lo = 0;
+    size_t hi = combos.size() / n_legs;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        const int* c = combos.data() + mid * n_legs;
+        if (std::lexicographical_compare(c, c + n_legs, indices.begin(), indices.end())) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == combos.size() / n_legs ||
+        !std::equal(indices.begin(), indices.end(), combos.begin() + lo * n_legs)) {
+        return npos;
+    }
+    
+    size_t mask = 0;
+    for (int i = 0; i < n_legs; ++i) {
+        if (signs[i] > 0) mask |= size_t(1) << i;
+    }
+    return (lo << n_legs) | mask;
+}
+
+// ============================================================================
+// STORE
+// ============================================================================
+
+void SessionStore::clear() {
+    metric_names_.clear();
+    columns_.clear();
+    metric_mins_.clear();
+    metric_maxs_.clear();
+    leg_offsets_.clear();
+    leg_indices_.clear();
+    leg_signs_.clear();
+    row_filters_.clear();
+    rejections_.clear();
+    rules_ = RuleProgram();
+    bounded_ = false;
+    valid_ = false;
+}
+
+void SessionStore::build(
+    const std::vector<ScoredStrategy>& strategies,
+    const std::vector<OptionData>& options,
+    const FilterParams& filter,
+    size_t max_rows,
+    std::vector<RejectionLog> rejections
+) {
+    clear();
+    filter_ = filter;
+    
+    const std::vector<MetricConfig> metrics = StrategyScorer::create_default_metrics();
+    for (const auto& metric : metrics) {
+        metric_names_.push_back(metric.name);
+    }
+    columns_.assign(metrics.size(), {});
+    leg_offsets_.push_back(0);
+    
+    // ========== PRÉ-FILTRE LARGE ==========
+    std::vector<size_t> rows;
+    if (max_rows == 0 || strategies.size() <= max_rows) {
+        rows.resize(strategies.size());
+        for (size_t i = 0; i < rows.size(); ++i) rows[i] = i;
+        append_rows(strategies, rows, options);
+        update_ranges();
+    } else {
+        // Normalisation sur l'ensemble valide complet (avant pré-filtre)
+        auto columns = StrategyScorer::extract_metric_columns(strategies, metrics);
+        StrategyScorer::compute_metric_ranges(columns, metric_mins_, metric_maxs_);
+        
+        const size_t per_metric = std::max<size_t>(max_rows / metrics.size(), 1);
+        std::vector<char> keep(strategies.size(), 0);
+        std::vector<std::pair<double, size_t>> sub_scores(strategies.size());
+        
+        for (size_t j = 0; j < metrics.size(); ++j) {
+            for (size_t i = 0; i < strategies.size(); ++i) {
+                sub_scores[i] = {StrategyScorer::calculate_score(
+                    columns[j][i], metric_mins_[j], metric_maxs_[j], metrics[j].scorer), i};
+            }
+            std::nth_element(sub_scores.begin(), sub_scores.begin() + per_metric, sub_scores.end(),
+                [](const auto& a, const auto& b) { return a.first > b.first; });
+            for (size_t k = 0; k < per_metric; ++k) {
+                keep[sub_scores[k].second] = 1;
+            }
+        }
+        for (size_t i = 0; i < keep.size(); ++i) {
+            if (keep[i]) rows.push_back(i);
+        }
+        append_rows(strategies, rows, options);
+        bounded_ = true;
+    }
+    
+    rejections_ = std::move(rejections);
+    valid_ = true;
+}
+
+void SessionStore::append_rows(
+    const std::vector<ScoredStrategy>& strategies,
+    const std::vector<size_t>& rows,
+    const std::vector<OptionData>& options
+) {
+    std::vector<OptionData> legs_data;
+    for (size_t i : rows) {
+        const auto& strat = strategies[i];
+        for (size_t j = 0; j < metric_names_.size(); ++j) {
+            columns_[j].push_back(StrategyScorer::extract_single_metric_value(strat, metric_names_[j]));
+        }
+        
+        leg_indices_.insert(leg_indices_.end(), strat.option_indices.begin(), strat.option_indices.end());
+        leg_signs_.insert(leg_signs_.end(), strat.signs.begin(), strat.signs.end());
+        leg_offsets_.push_back(leg_indices_.size());
+        
+        legs_data.clear();
+        for (int idx : strat.option_indices) {
+            legs_data.push_back(options[idx]);
+        }
+        // Mêmes prix exécutables que l'évaluation (vente au bid)
+        StrategyCalculator::apply_execution(legs_data, strat.signs, filter_.execution);
+        row_filters_.push_back({
+            std::abs(strat.total_premium),
+            strat.total_delta,
+            strat.max_loss_left,
+            strat.max_loss_right,
+            StrategyCalculator::min_sold_premium(legs_data, strat.signs),
+            strat.put_count,
+            strat.call_count
+        });
+    }
+}
+
+void SessionStore::update_ranges() {
+    StrategyScorer::compute_metric_ranges(columns_, metric_mins_, metric_maxs_);
+}
+
+// ============================================================================
+// REFILTRE INCRÉMENTAL
+// ============================================================================
+
+bool SessionStore::may_pass(RejectReason reason, float value, const FilterParams& filter) {
+    // Valeur journalisée en float: marge en faveur de la ré-évaluation
+    auto tol = [](double threshold) { return 1e-6 * std::max(1.0, std::abs(threshold)); };
+    
+    switch (reason) {
+        case RejectReason::USELESS_SELL:
+            return value >= filter.min_premium_sell - tol(filter.min_premium_sell);
+        case RejectReason::PUT_OPEN:
+            return value <= filter.ouvert_gauche;
+        case RejectReason::CALL_OPEN:
+            return value <= filter.ouvert_droite;
+        case RejectReason::PREMIUM:
+            return value <= filter.max_premium_params + tol(filter.max_premium_params);
+        case RejectReason::DELTA:
+            return value >= filter.delta_min - tol(filter.delta_min) &&
+                   value <= filter.delta_max + tol(filter.delta_max);
+        case RejectReason::LOSS_LEFT:
+            return value >= -filter.max_loss_left - tol(filter.max_loss_left);
+        case RejectReason::LOSS_RIGHT:
+            return value >= -filter.max_loss_right - tol(filter.max_loss_right);
+        default:
+            // Motifs indépendants des seuils (ou des seules limites de prix)
+            return false;
+    }
+}
+
+RejectInfo SessionStore::check_row(size_t row, const FilterParams& filter) const {
+    const RowFilterValues& v = row_filters_[row];
+    
+    // Même ordre que calculate: le motif journalisé est le premier filtre en échec
+    if (v.min_sold_premium < filter.min_premium_sell) {
+        return {RejectReason::USELESS_SELL, v.min_sold_premium};
+    }
+    if (v.net_short_puts > filter.ouvert_gauche) {
+        return {RejectReason::PUT_OPEN, static_cast<double>(v.net_short_puts)};
+    }
+    if (v.net_short_calls > filter.ouvert_droite) {
+        return {RejectReason::CALL_OPEN, static_cast<double>(v.net_short_calls)};
+    }
+    if (v.abs_premium > filter.max_premium_params) {
+        return {RejectReason::PREMIUM, v.abs_premium};
+    }
+    if (v.delta < filter.delta_min || v.delta > filter.delta_max) {
+        return {RejectReason::DELTA, v.delta};
+    }
+    if (v.loss_left < -filter.max_loss_left) {
+        return {RejectReason::LOSS_LEFT, v.loss_left};
+    }
+    if (v.loss_right < -filter.max_loss_right) {
+        return {RejectReason::LOSS_RIGHT, v.loss_right};
+    }
+    return {};
+}
+
+size_t SessionStore::tighten(const FilterParams& filter) {
+    if (!can_refilter()) {
+        throw std::runtime_error("Refiltre impossible: store borné ou sans journal des rejets.");
+    }
+    
+    std::vector<int> indices, signs;
+    size_t kept = 0;
+    size_t leg_pos = 0;
+    
+    // Compactage en place des lignes conservées
+    for (size_t row = 0; row < size(); ++row) {
+        const size_t begin = leg_offsets_[row];
+        const size_t end = leg_offsets_[row + 1];
+        const RejectInfo info = check_row(row, filter);
+        
+        if (info.reason != RejectReason::NONE) {
+            indices.assign(leg_indices_.begin() + begin, leg_indices_.begin() + end);
+            signs.assign(leg_signs_.begin() + begin, leg_signs_.begin() + end);
+            RejectionLog& log = rejections_[indices.size() - 1];
+            const size_t task = log.find_task(indices, signs);
+            if (task != RejectionLog::npos) {
+                log.reasons[task] = info.reason;
+                log.values[task] = static_cast<float>(info.value);
+            }
+            continue;
+        }
+        
+        for (auto& column : columns_) {
+            column[kept] = column[row];
+        }
+        row_filters_[kept] = row_filters_[row];
+        for (size_t k = begin; k < end; ++k, ++leg_pos) {
+            leg_indices_[leg_pos] = leg_indices_[k];
+            leg_signs_[leg_pos] = leg_signs_[k];
+        }
+        leg_offsets_[++kept] = leg_pos;
+    }
+    
+    const size_t dropped = size() - kept;
+    for (auto& column : columns_) {
+        column.resize(kept);
+    }
+    row_filters_.resize(kept);
+    leg_offsets_.resize(kept + 1);
+    leg_indices_.resize(leg_pos);
+    leg_signs_.resize(leg_pos);
+    
+    update_ranges();
+    return dropped;
+}
+
+void SessionStore::append(
+    const std::vector<ScoredStrategy>& strategies,
+    const std::vector<OptionData>& options
+) {
+    std::vector<size_t> rows(strategies.size());
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = i;
+    append_rows(strategies, rows, options);
+    update_ranges();
+}
+
+// ============================================================================
+// CLASSEMENT
+// ============================================================================
+
+std::vector<MetricConfig> SessionStore::aligned_metrics(std::vector<MetricConfig> metrics) const {
+    if (!valid_) {
+        throw std::runtime_error("Store de session vide. Lancez un run avec keep_session=True.");
+    }
+    
+    StrategyScorer::normalize_weights(metrics);
+    
+    // Sans copier les colonnes: une config par colonne du store
+    std::vector<MetricConfig> aligned;
+    const std::vector<MetricConfig> defaults = StrategyScorer::create_default_metrics();
+    for (const auto& name : metric_names_) {
+        auto it = std::find_if(defaults.begin(), defaults.end(),
+            [&name](const MetricConfig& m) { return m.name == name; });
+        aligned.push_back(*it);
+        aligned.back().weight = 0.0;
+    }
+    for (const auto& metric : metrics) {
+        auto it = std::find(metric_names_.begin(), metric_names_.end(), metric.name);
+        if (it == metric_names_.end()) {
+            throw std::invalid_argument("Métrique absente du store de session: " + metric.name);
+        }
+        aligned[static_cast<size_t>(it - metric_names_.begin())] = metric;
+    }
+    return aligned;
+}
+
+std::vector<std::pair<size_t, double>> SessionStore::rank(
+    std::vector<MetricConfig> metrics,
+    int top_n
+) const {
+    const std::vector<MetricConfig> aligned = aligned_metrics(std::move(metrics));
+    const std::vector<double> scores = StrategyScorer::score_columns(columns_, aligned, metric_mins_, metric_maxs_);
+    
+    std::vector<std::pair<size_t, double>> ranked;
+    for (size_t row : StrategyScorer::select_top_indices(scores, top_n)) {
+        ranked.emplace_back(row, scores[row]);
+    }
+    return ranked;
+}
+
+ScoreDecomposition SessionStore::decompose(
+    std::vector<MetricConfig> metrics,
+    int top_k
+) const {
+    const std::vector<MetricConfig> aligned = aligned_metrics(std::move(metrics));
+    const std::vector<double> scores = StrategyScorer::score_columns(columns_, aligned, metric_mins_, metric_maxs_);
+    const size_t n_metrics = aligned.size();
+    
+    ScoreDecomposition result;
+    result.metric_names = metric_names_;
+    result.metric_mins = metric_mins_;
+    result.metric_maxs = metric_maxs_;
+    for (const auto& metric : aligned) {
+        result.weights.push_back(metric.weight);
+    }
+    result.rows = StrategyScorer::select_top_indices(scores, top_k);
+    
+    std::vector<char> in_top(size(), 0);
+    result.sub_scores.reserve(result.rows.size() * n_metrics);
+    for (size_t row : result.rows) {
+        in_top[row] = 1;
+        result.scores.push_back(scores[row]);
+        for (size_t j = 0; j < n_metrics; ++j) {
+            result.sub_scores.push_back(StrategyScorer::calculate_score(
+                columns_[j][row], metric_mins_[j], metric_maxs_[j], aligned[j].scorer));
+        }
+    }
+    
+    // ========== BORNE DE PROMOTION: meilleur sous-score hors top_k ==========
+    result.outside_max.assign(n_metrics, 0.0);
+    const int64_t n_rows = static_cast<int64_t>(size());
+    for (size_t j = 0; j < n_metrics; ++j) {
+        // Max par thread puis section critique (pas de reduction(max) en OpenMP 2.0 / MSVC)
+        double best = 0.0;
+        #pragma omp parallel
+        {
+            double local_best = 0.0;
+            #pragma omp for schedule(static) nowait
+            for (int64_t i = 0; i < n_rows; ++i) {
+                if (!in_top[i]) {
+                    local_best = std::max(local_best, StrategyScorer::calculate_score(
+                        columns_[j][i], metric_mins_[j], metric_maxs_[j], aligned[j].scorer));
+                }
+            }
+            #pragma omp critical
+            best = std::max(best, local_best);
+        }
+        result.outside_max[j] = best;
+    }
+    return result;
+}
+
+void SessionStore::legs(size_t row, std::vector<int>& indices, std::vector<int>& signs) const {
+    indices.assign(leg_indices_.begin() + leg_offsets_[row], leg_indices_.begin() + leg_offsets_[row + 1]);
+    signs.assign(leg_signs_.begin() + leg_offsets_[row], leg_signs_.begin() + leg_offsets_[row + 1]);
+}
+
+} // namespace strategy
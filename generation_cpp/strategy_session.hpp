@@ -0,0 +1,186 @@
+/**
+ * Store de session - Header
+ * Conserve les colonnes de métriques de l'ensemble valide du dernier run
+ * pour re-classer sans ré-énumérer les combinaisons, et le journal des
+ * rejets pour re-filtrer de façon incrémentale
+ */
+
+#pragma once
+
+#include "strategy_metrics.hpp"
+#include "strategy_scoring.hpp"
+#include <vector>
+#include <string>
+#include <utility>
+
+namespace strategy {
+
+/**
+ * Journal des rejets d'un niveau n_legs. Les combinaisons sont dans l'ordre
+ * de next_combination (donc triées); la tâche t correspond à la combinaison
+ * t >> n_legs et au masque de signes t & (2^n_legs - 1) (bit i = jambe i long).
+ */
+struct RejectionLog {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    
+    int n_legs = 0;
+    std::vector<int> combos;            // n_combos x n_legs, à plat
+    std::vector<RejectReason> reasons;  // Par tâche (NONE = valide)
+    std::vector<float> values;          // Valeur sur laquelle le filtre a échoué
+    
+    size_t n_tasks() const { return reasons.size(); }
+    void task_legs(size_t task, std::vector<int>& indices, std::vector<int>& signs) const;
+    
+    // Tâche d'une stratégie (recherche dichotomique), npos si absente
+    size_t find_task(const std::vector<int>& indices, const std::vector<int>& signs) const;
+};
+
+/**
+ * Décomposition du score des top_k lignes: sous-scores normalisés par
+ * métrique (calculate_score), dans l'ordre des colonnes du store.
+ * Pour des poids w quelconques, une ligne hors du top_k a un score
+ * <= w . outside_max: si le top_n-ième score local est au-dessus, le
+ * re-tri local est exact, sinon un appel moteur est nécessaire.
+ */
+struct ScoreDecomposition {
+    std::vector<std::string> metric_names;
+    std::vector<double> weights;       // Poids normalisés utilisés
+    std::vector<double> metric_mins;
+    std::vector<double> metric_maxs;
+    std::vector<size_t> rows;          // Lignes du store, par score décroissant
+    std::vector<double> scores;
+    std::vector<double> sub_scores;    // rows.size() x n_metrics, row-major
+    std::vector<double> outside_max;   // Meilleur sous-score hors top_k, par métrique
+};
+
+/**
+ * Colonnes de métriques (une par métrique de scoring par défaut) et jambes
+ * de chaque stratégie valide. Les min/max de normalisation sont ceux de
+ * l'ensemble valide complet: ils ne dépendent pas des poids, donc un rescore
+ * reproduit exactement le classement d'un run complet.
+ * Seuls les gagnants sont ensuite recalculés (P&L array, breakevens).
+ */
+class SessionStore {
+public:
+    void clear();
+    
+    /**
+     * Remplit le store à partir de l'ensemble valide
+     *
+     * @param options Données des options du cache (valeurs de filtre par jambe)
+     * @param max_rows 0 = tout garder. Sinon pré-filtre large: union des
+     *                 max_rows / n_metrics meilleures lignes de chaque métrique
+     *                 prise isolément
+     * @param rejections Journal des rejets par n_legs (vide = pas de refiltre)
+     */
+    void build(
+        const std::vector<ScoredStrategy>& strategies,
+        const std::vector<OptionData>& options,
+        const FilterParams& filter,
+        size_t max_rows = 0,
+        std::vector<RejectionLog> rejections = {}
+    );
+    
+    bool valid() const { return valid_; }
+    size_t size() const { return leg_offsets_.empty() ? 0 : leg_offsets_.size() - 1; }
+    const FilterParams& filter() const { return filter_; }
+    
+    // Refiltre possible: store complet et journal des rejets présent
+    bool can_refilter() const { return valid_ && !bounded_ && !rejections_.empty(); }
+    int max_legs() const { return static_cast<int>(rejections_.size()); }
+    std::vector<RejectionLog>& rejections() { return rejections_; }
+    
+    /**
+     * Retire les lignes qui ne passent plus les nouveaux seuils et journalise
+     * leur motif de rejet. Les limites de prix doivent être inchangées.
+     *
+     * @return Nombre de lignes retirées
+     */
+    size_t tighten(const FilterParams& filter);
+    
+    /**
+     * Ajoute des stratégies valides (tâches ré-évaluées après relâchement)
+     * puis recalcule les bornes de normalisation
+     */
+    void append(
+        const std::vector<ScoredStrategy>& strategies,
+        const std::vector<OptionData>& options
+    );
+    
+    void set_filter(const FilterParams& filter) { filter_ = filter; }
+    
+    // Règles du run (inchangées par le refiltre: les rejets RULE restent définitifs)
+    void set_rules(RuleProgram rules) { rules_ = std::move(rules); }
+    const RuleProgram& rules() const { return rules_; }
+    
+    /**
+     * Une tâche rejetée pour ce motif et cette valeur peut-elle passer les
+     * nouveaux seuils ? false = toujours rejetée, true = à ré-évaluer
+     * (un filtre plus loin dans calculate peut encore la rejeter)
+     */
+    static bool may_pass(RejectReason reason, float value, const FilterParams& filter);
+    
+    /**
+     * Classe les lignes du store pour ces métriques (poids normalisés ici)
+     *
+     * @return (ligne, score) des top_n meilleurs scores, par score décroissant
+     */
+    std::vector<std::pair<size_t, double>> rank(
+        std::vector<MetricConfig> metrics,
+        int top_n
+    ) const;
+    
+    /**
+     * Sous-scores des top_k lignes et borne de promotion (voir ScoreDecomposition)
+     */
+    ScoreDecomposition decompose(
+        std::vector<MetricConfig> metrics,
+        int top_k
+    ) const;
+    
+    void legs(size_t row, std::vector<int>& indices, std::vector<int>& signs) const;
+
+private:
+    // Valeurs des filtres paramétrables d'une ligne
+    struct RowFilterValues {
+        double abs_premium;
+        double delta;
+        double loss_left;
+        double loss_right;
+        double min_sold_premium;
+        int net_short_puts;
+        int net_short_calls;
+    };
+    
+    void append_rows(
+        const std::vector<ScoredStrategy>& strategies,
+        const std::vector<size_t>& rows,
+        const std::vector<OptionData>& options
+    );
+    void update_ranges();
+    
+    // Métriques alignées sur les colonnes du store (poids 0 si absentes), poids normalisés
+    std::vector<MetricConfig> aligned_metrics(std::vector<MetricConfig> metrics) const;
+    
+    RejectInfo check_row(size_t row, const FilterParams& filter) const;
+    
+    std::vector<std::string> metric_names_;
+    std::vector<std::vector<double>> columns_;
+    std::vector<double> metric_mins_;
+    std::vector<double> metric_maxs_;
+    
+    // Jambes au format CSR: ligne i = [leg_offsets_[i], leg_offsets_[i + 1])
+    std::vector<size_t> leg_offsets_;
+    std::vector<int> leg_indices_;
+    std::vector<int> leg_signs_;
+    
+    std::vector<RowFilterValues> row_filters_;
+    std::vector<RejectionLog> rejections_;
+    
+    FilterParams filter_{};
+    RuleProgram rules_;
+    bool bounded_ = false;
+    bool valid_ = false;
+};
+
+} // namespace strategy
@@ -0,0 +1,124 @@
+/**
+ * Implémentation du sketch de quantiles KLL
+ */
+
+#include "strategy_sketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace strategy {
+
+QuantileSketch::QuantileSketch(int k) : k_(std::max(k, 8)) {
+    levels_.emplace_back();
+    odd_offset_.push_back(false);
+}
+
+size_t QuantileSketch::capacity(size_t level) const {
+    // Le niveau le plus haut a k places, chaque niveau inférieur 2/3 de moins
+    const size_t depth = levels_.size() - 1 - level;
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(k_ * std::pow(2.0 / 3.0, depth))));
+}
+
+void QuantileSketch::insert(double value) {
+    if (!std::isfinite(value)) {
+        return;
+    }
+    levels_[0].push_back(value);
+    ++n_;
+    if (levels_[0].size() >= capacity(0)) {
+        compress();
+    }
+}
+
+void QuantileSketch::compress() {
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        if (levels_[h].size() < capacity(h)) {
+            continue;
+        }
+        if (h + 1 == levels_.size()) {
+            levels_.emplace_back();
+            odd_offset_.push_back(false);
+        }
+        
+        // Compacter: trier et promouvoir un élément sur deux (poids x2)
+        std::vector<double>& level = levels_[h];
+        std::sort(level.begin(), level.end());
+        const bool keep_last = level.size() % 2 == 1;
+        const double last = level.back();
+        const size_t paired = level.size() - (keep_last ? 1 : 0);
+        
+        for (size_t i = odd_offset_[h] ? 1 : 0; i < paired; i += 2) {
+            levels_[h + 1].push_back(level[i]);
+        }
+        odd_offset_[h] = !odd_offset_[h];
+        level.clear();
+        if (keep_last) {
+            level.push_back(last);
+        }
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    while (levels_.size() < other.levels_.size()) {
+        levels_.emplace_back();
+        odd_offset_.push_back(false);
+    }
+    for (size_t h = 0; h < other.levels_.size(); ++h) {
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+    }
+    n_ += other.n_;
+    compress();
+}
+
+void QuantileSketch::prepare() {
+    std::vector<std::pair<double, double>> items;
+    for (size_t h = 0; h < levels_.size(); ++h) {
+        const double weight = std::ldexp(1.0, static_cast<int>(h));
+        for (double value : levels_[h]) {
+            items.emplace_back(value, weight);
+        }
+    }
+    std::sort(items.begin(), items.end());
+    
+    sorted_values_.clear();
+    cumulative_weights_.clear();
+    double total = 0.0;
+    for (const auto& [value, weight] : items) {
+        total += weight;
+        if (!sorted_values_.empty() && sorted_values_.back() == value) {
+            cumulative_weights_.back() = total;
+        } else {
+            sorted_values_.push_back(value);
+            cumulative_weights_.push_back(total);
+        }
+    }
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (sorted_values_.empty()) {
+        return 0.0;
+    }
+    const double target = std::clamp(q, 0.0, 1.0) * cumulative_weights_.back();
+    auto it = std::lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), target);
+    if (it == cumulative_weights_.end()) {
+        return sorted_values_.back();
+    }
+    return sorted_values_[static_cast<size_t>(it - cumulative_weights_.begin())];
+}
+
+double QuantileSketch::cdf(double value) const {
+    if (sorted_values_.empty()) {
+        return 0.5;
+    }
+    const double total = cumulative_weights_.back();
+    auto it = std::lower_bound(sorted_values_.begin(), sorted_values_.end(), value);
+    const size_t i = static_cast<size_t>(it - sorted_values_.begin());
+    const double below = i > 0 ? cumulative_weights_[i - 1] : 0.0;
+    const double equal = (it != sorted_values_.end() && *it == value)
+        ? cumulative_weights_[i] - below
+        : 0.0;
+    return (below + 0.5 * equal) / total;
+}
+
+} // namespace strategy
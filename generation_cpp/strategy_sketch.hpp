@@ -0,0 +1,56 @@
+/**
+ * Sketch de quantiles fusionnable (KLL) - Header
+ * Remplace le tri de millions de valeurs pour les normaliseurs
+ * PERCENTILE et ROBUST
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace strategy {
+
+/**
+ * Sketch KLL: niveaux compactés de capacité décroissante géométriquement,
+ * un élément du niveau h pèse 2^h. Erreur de rang ~ 1/k, mémoire O(k).
+ * Deux sketches se fusionnent niveau par niveau (un par thread ou par
+ * bloc, puis fusion). Le compactage alterne les décalages pair/impair,
+ * donc le résultat est déterministe pour un même ordre de fusion.
+ */
+class QuantileSketch {
+public:
+    explicit QuantileSketch(int k = 256);
+    
+    void insert(double value);
+    void merge(const QuantileSketch& other);
+    
+    uint64_t count() const { return n_; }
+    
+    /**
+     * Prépare la table triée (valeur, poids cumulé) des requêtes
+     * À appeler après la dernière insertion/fusion
+     */
+    void prepare();
+    
+    // Quantile q dans [0, 1] (prepare() requis)
+    double quantile(double q) const;
+    
+    // Rang moyen normalisé dans [0, 1]: (#< value + #== value / 2) / n (prepare() requis)
+    double cdf(double value) const;
+
+private:
+    size_t capacity(size_t level) const;
+    void compress();
+    
+    int k_;
+    uint64_t n_ = 0;
+    std::vector<std::vector<double>> levels_;
+    std::vector<bool> odd_offset_;   // Décalage alterné du compactage, par niveau
+    
+    // Table de requêtes (prepare)
+    std::vector<double> sorted_values_;
+    std::vector<double> cumulative_weights_;   // Poids des valeurs <= sorted_values_[i]
+};
+
+} // namespace strategy
@@ -5,15 +5,96 @@ from __future__ import annotations
 import numpy
 import numpy.typing
 import typing
-__all__: list[str] = ['init_options_cache', 'process_combinations_batch_with_scoring', 'stop', 'reset_stop', 'is_stop_requested']
-def init_options_cache(premiums: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], deltas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], gammas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], vegas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], thetas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], ivs: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], average_pnls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], sigma_pnls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], strikes: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], is_calls: typing.Annotated[numpy.typing.ArrayLike, numpy.bool], rolls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], rolls_quarterly: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], rolls_sum: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], pnl_matrix: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], prices: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], mixture: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], average_mix: typing.SupportsFloat) -> None:
+__all__: list[str] = ['init_options_cache', 'process_combinations_batch_with_scoring', 'process_combinations_batch_multi_profile', 'rescore', 'score_decomposition', 'refilter', 'stop', 'reset_stop', 'is_stop_requested']
+def init_options_cache(premiums: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], deltas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], gammas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], vegas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], thetas: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], ivs: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], average_pnls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], sigma_pnls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], strikes: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], is_calls: typing.Annotated[numpy.typing.ArrayLike, numpy.bool], rolls: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], rolls_quarterly: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], rolls_sum: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], pnl_matrix: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], prices: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], mixture: typing.Annotated[numpy.typing.ArrayLike, numpy.float64], average_mix: typing.SupportsFloat, open_interests: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, volumes: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, bid_sizes: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, ask_sizes: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, bids: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, asks: typing.Annotated[numpy.typing.ArrayLike, numpy.float64] | None = None, expiries: typing.Annotated[numpy.typing.ArrayLike, numpy.int32] | None = None) -> None:
     """
                   Initialise le cache global avec toutes les données des options.
                   Doit être appelé une seule fois avant process_combinations_batch.
+                  open_interests, volumes, bid_sizes, ask_sizes: liquidité optionnelle (0 si absente).
+                  bids, asks: cotations optionnelles pour l'exécution (0 = premium mid).
+                  expiries: identifiant d'échéance par option (0 si absent: une seule échéance).
+                  Vide le store de session du run précédent (keep_session).
     """
-def process_combinations_batch_with_scoring(n_legs: typing.SupportsInt, max_loss_left: typing.SupportsFloat, max_loss_right: typing.SupportsFloat, max_premium_params: typing.SupportsFloat, ouvert_gauche: typing.SupportsInt, ouvert_droite: typing.SupportsInt, min_premium_sell: typing.SupportsFloat, delta_min: typing.SupportsFloat, delta_max: typing.SupportsFloat, limit_left: typing.SupportsFloat, limit_right: typing.SupportsFloat, top_n: typing.SupportsInt = 10, custom_weights: dict = {}) -> list:
+def process_combinations_batch_with_scoring(n_legs: typing.SupportsInt, max_loss_left: typing.SupportsFloat, max_loss_right: typing.SupportsFloat, max_premium_params: typing.SupportsFloat, ouvert_gauche: typing.SupportsInt, ouvert_droite: typing.SupportsInt, min_premium_sell: typing.SupportsFloat, delta_min: typing.SupportsFloat, delta_max: typing.SupportsFloat, limit_left: typing.SupportsFloat, limit_right: typing.SupportsFloat, top_n: typing.SupportsInt = 10, custom_weights: dict = {}, dedup_mode: str = 'exact', dedup_tolerance: typing.SupportsFloat = 0.0, selection: str = 'top_n', mmr_lambda: typing.SupportsFloat = 0.7, diversity: str = 'pnl', pareto_fronts: typing.SupportsInt = 1, pareto_objectives: dict = {}, keep_session: bool = False, session_max_rows: typing.SupportsInt = 0, group_by: str = 'n_legs', group_size: typing.SupportsInt = 0, fixed_ranges: dict = {}, normalizers: dict = {}, rules: list = [], custom_metrics: dict = {}, liquidity: dict = {}, use_bid_ask: bool = False, fee_per_contract: typing.SupportsFloat = 0.0, prune_dominated: bool = False, generator: str = 'masks', search: dict = {}, expiry_policy: str = 'any', max_expiries: typing.SupportsInt = 0, constraints: dict = {}) -> list:
     """
                   Génère toutes les combinaisons de n_legs options avec SCORING et RANKING en C++.
+                  dedup_mode: "exact" (même payoff), "linf" ou "l2" (quasi-doublons à
+                  dedup_tolerance près, P&L pondéré par la mixture).
+                  selection: "top_n", "mmr" (score vs diversité, mmr_lambda dans [0, 1],
+                  diversity "pnl" ou "legs") ou "pareto" (pareto_fronts premiers fronts non
+                  dominés sur pareto_objectives, ex: {"average_pnl": "max", "sigma_pnl": "min"}).
+                  keep_session: conserve les métriques de l'ensemble valide pour rescore() et refilter()
+                  (session_max_rows > 0 borne le store par un pré-filtre large).
+                  selection "grouped": les group_size (défaut top_n) meilleures de chaque
+                  groupe group_by ("n_legs", "call_put", "structure" ou "expiry": ensemble
+                  des échéances des jambes, ex: "E0+E1"), clé "group".
+                  fixed_ranges: bornes {métrique: (lo, hi)} de normalisation fixes; le score
+                  est final à l'évaluation et seul un heap borné est conservé (sans store).
+                  normalizers: {métrique: "max" | "min_max" | "count" | "percentile" | "robust"};
+                  "percentile" score le rang de la valeur, "robust" la place dans médiane +/- 2 IQR
+                  (quantiles approchés par sketch, ~1 % d'erreur de rang, alimentés pendant
+                  l'énumération). Incompatible avec keep_session.
+                  rules: règles évaluées dans le kernel, [(champ, op, valeur) ou
+                  (champ, op, facteur, champ2)], ex: [("max_profit", ">=", 3.0, "abs_max_loss"),
+                  ("n_breakevens", "<=", 2)]; op parmi <, <=, >, >=, ==, !=.
+                  custom_metrics: métriques de scoring définies par expression, {nom: (expression,
+                  poids[, scorer])}, ex: {"pnl_per_risk": ("average_pnl / (1 + abs(max_loss))", 0.2)};
+                  opérateurs + - * / ^, fonctions abs, sqrt, log, exp, min, max; scorer "higher"
+                  (défaut), "lower", "moderate" ou "positive". Utilisables dans normalizers et fixed_ranges.
+                  liquidity: planchers par jambe {"min_open_interest", "min_volume", "min_quote_size"}
+                  (taille à l'ask pour un achat, au bid pour une vente); les options qui ne
+                  passent pour aucun signe sont retirées avant l'énumération.
+                  use_bid_ask: achats à l'ask, ventes au bid (cotations de init_options_cache);
+                  fee_per_contract: frais par jambe. Premium, P&L et métriques sont exécutables.
+                  prune_dominated: ne génère pas les jambes dominées (même type et échéance, payoff au moins
+                  aussi bon, prix exécutable au moins aussi bon). Les ventes sous min_premium_sell
+                  et les jambes illiquides ne sont jamais générées.
+                  generator: "masks" (combinaisons puis masques de signes) ou "dfs" (jambe par
+                  jambe, sous-arbres coupés dès que premium, delta ou average_pnl ne peuvent plus
+                  passer) ou "mitm" (jonction de demi-stratégies triées par premium, seules les
+                  paires dans les fenêtres premium/delta sont évaluées; pour 4 à 6 jambes) ou
+                  "clique" (cliques du graphe de compatibilité des jambes, bitsets de 64 bits:
+                  même contrat de signes opposés et paires hors fenêtres jamais énumérés).
+                  "beam": recherche heuristique non exhaustive (beam search sur l'ajout de
+                  jambes puis recuit simulé optionnel), même kernel et objectif = métriques du
+                  ranking; réglée par search={"beam_width", "anneal_chains", "anneal_steps",
+                  "temperature", "seed", "time_limit"} (résultat reproductible pour une graine).
+                  dfs, mitm, clique et beam: incompatibles avec keep_session sans session_max_rows.
+                  expiry_policy: "any", "single" (une échéance par stratégie: l'univers est
+                  partitionné par échéance, aucune combinaison croisée n'est générée),
+                  "at_most" (au plus max_expiries échéances) ou "calendar" (exactement deux).
+                  constraints: structure des jambes {"strike_min", "strike_max", "min_spacing",
+                  "max_spacing" (écart entre strikes distincts consécutifs), "min_calls", "max_calls",
+                  "min_puts", "max_puts", "symmetric_wings" (écarts en palindrome)}; avec "masks",
+                  les combinaisons sont parcourues par strike et les plages infaisables sautées.
+    """
+def process_combinations_batch_multi_profile(n_legs: typing.SupportsInt, max_loss_left: typing.SupportsFloat, max_loss_right: typing.SupportsFloat, max_premium_params: typing.SupportsFloat, ouvert_gauche: typing.SupportsInt, ouvert_droite: typing.SupportsInt, min_premium_sell: typing.SupportsFloat, delta_min: typing.SupportsFloat, delta_max: typing.SupportsFloat, limit_left: typing.SupportsFloat, limit_right: typing.SupportsFloat, weight_profiles: list, top_n: typing.SupportsInt = 1000, liquidity: dict = {}, use_bid_ask: bool = False, fee_per_contract: typing.SupportsFloat = 0.0, prune_dominated: bool = False, generator: str = 'masks', search: dict = {}, expiry_policy: str = 'any', max_expiries: typing.SupportsInt = 0, constraints: dict = {}) -> list:
+    """
+                  Comme process_combinations_batch_with_scoring, pour plusieurs profils de
+                  poids (liste de dicts) en une seule énumération. Retourne une liste de
+                  résultats par profil, dans l'ordre de weight_profiles. liquidity, use_bid_ask,
+                  fee_per_contract, prune_dominated, generator, search, expiry_policy,
+                  max_expiries et constraints: comme
+                  process_combinations_batch_with_scoring.
+    """
+def rescore(custom_weights: dict = {}, top_n: typing.SupportsInt = 10) -> list:
+    """
+                  Re-classe l'ensemble valide du dernier run (keep_session=True) avec de
+                  nouveaux poids, sans ré-énumérer. Seuls les top_n gagnants sont recalculés.
+    """
+def score_decomposition(custom_weights: dict = {}, top_k: typing.SupportsInt = 1000) -> dict:
+    """
+                  Sous-scores normalisés (top_k x n_metrics) des top_k stratégies du store de
+                  session, avec les min/max de normalisation. Re-pondération locale:
+                  scores = sub_scores @ w. Le re-tri local est exact tant que le top_n-ième
+                  score reste >= w @ outside_max (promotion_bound pour les poids courants).
+    """
+def refilter(max_loss_left: typing.SupportsFloat, max_loss_right: typing.SupportsFloat, max_premium_params: typing.SupportsFloat, ouvert_gauche: typing.SupportsInt, ouvert_droite: typing.SupportsInt, min_premium_sell: typing.SupportsFloat, delta_min: typing.SupportsFloat, delta_max: typing.SupportsFloat, limit_left: typing.SupportsFloat, limit_right: typing.SupportsFloat, top_n: typing.SupportsInt = 1000, custom_weights: dict = {}) -> list:
+    """
+                  Applique de nouveaux seuils de filtre au dernier run (keep_session=True,
+                  session_max_rows=0) sans ré-énumérer: resserrer retire des lignes,
+                  relâcher ne ré-évalue que les tâches rejetées sur ce seuil.
+                  Modifier limit_left / limit_right relance un run complet.
     """
 def stop() -> None:
     """
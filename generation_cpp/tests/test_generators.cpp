@@ -0,0 +1,126 @@
+/**
+ * Tests des générateurs de combinaisons: les générateurs exacts retournent
+ * le même ensemble de stratégies valides que l'énumération combinaisons x
+ * masques de signes (GeneratorMode::MASKS), sans doublon. Le beam search,
+ * non exhaustif, est reproductible pour une graine donnée.
+ */
+
+#include "bindings.cpp"
+#include "test_support.hpp"
+
+// Filtres couvrant bornes larges, pertes serrées, échéances et coûts d'exécution
+struct GeneratorCase {
+    const char* name;
+    int n_strikes;
+    int n_expiries;
+    int max_legs;
+    FilterParams filter;
+};
+
+static std::vector<GeneratorCase> generator_cases() {
+    std::vector<GeneratorCase> cases;
+
+    FilterParams loose{1e9, 1e9, 0.6, 2, 2, 0.3, -0.2, 0.3, 0.0, 1e9};
+    cases.push_back({"bornes larges", 12, 1, 4, loose});
+
+    FilterParams tight{1.5, 1.0, 5.0, 2, 2, 0.1, -5.0, 5.0, 92.0, 106.0};
+    tight.execution = ExecutionCosts{true, 0.01};
+    cases.push_back({"pertes serrées, bid/ask", 12, 1, 4, tight});
+
+    FilterParams calendar{3.0, 3.0, 2.0, 2, 2, 0.1, -1.0, 1.0, 90.0, 106.0};
+    calendar.expiry.mode = ExpiryMode::AT_MOST;
+    calendar.expiry.max_expiries = 2;
+    cases.push_back({"deux échéances", 8, 2, 3, calendar});
+
+    FilterParams single = calendar;
+    single.expiry.mode = ExpiryMode::SINGLE;
+    cases.push_back({"une échéance par stratégie", 8, 2, 4, single});
+
+    return cases;
+}
+
+/**
+ * Compare un générateur à l'énumération de référence sur chaque cas
+ */
+static void check_generator(GeneratorMode generator, const char* label) {
+    for (const auto& test_case : generator_cases()) {
+        load_synthetic_cache(test_case.n_strikes, test_case.n_expiries);
+
+        const auto reference = enumerate_strategies(test_case.max_legs, test_case.filter);
+        const auto found = enumerate_strategies(test_case.max_legs, test_case.filter,
+                                                nullptr, nullptr, 0, nullptr, generator);
+
+        const auto reference_keys = strategy_keys(reference);
+        const auto found_keys = strategy_keys(found);
+        if (found_keys != reference_keys) {
+            std::fprintf(stderr, "%s, %s: %zu stratégies, référence %zu\n",
+                         label, test_case.name, found_keys.size(), reference_keys.size());
+        }
+        CHECK(!reference_keys.empty());
+        CHECK(found_keys == reference_keys);
+        CHECK(found.size() == found_keys.size());
+    }
+}
+
+// Séquence de sortie (jambes, signes et premium), sensible à l'ordre
+static std::vector<std::vector<int>> output_sequence(const std::vector<ScoredStrategy>& strategies,
+                                                     std::vector<double>& premiums) {
+    std::vector<std::vector<int>> sequence;
+    premiums.clear();
+    for (const auto& strat : strategies) {
+        sequence.push_back(legs_key(strat.option_indices, strat.signs));
+        premiums.push_back(strat.total_premium);
+    }
+    return sequence;
+}
+
+/**
+ * Beam search: même sortie, dans le même ordre, d'un appel à l'autre et quel
+ * que soit le nombre de threads; toutes les stratégies trouvées sont valides
+ */
+static void check_beam_determinism() {
+    const GeneratorCase test_case = generator_cases().front();
+    load_synthetic_cache(test_case.n_strikes, test_case.n_expiries);
+
+    SearchParams search;
+    search.beam_width = 64;
+    search.anneal_chains = 16;
+    search.anneal_steps = 1500;
+    search.seed = 42;
+
+    auto run_beam = [&](int n_threads, std::vector<double>& premiums) {
+        omp_set_num_threads(n_threads);
+        const auto found = enumerate_strategies(test_case.max_legs, test_case.filter, nullptr, nullptr,
+                                                0, nullptr, GeneratorMode::BEAM, &search);
+        return output_sequence(found, premiums);
+    };
+
+    // Au moins 4 threads, même sur une machine à un cœur
+    const int max_threads = omp_get_max_threads();
+    const int n_threads = std::max(max_threads, 4);
+    std::vector<double> premiums, premiums_again, premiums_single;
+    const auto first = run_beam(n_threads, premiums);
+    const auto again = run_beam(n_threads, premiums_again);
+    const auto single = run_beam(1, premiums_single);
+    omp_set_num_threads(max_threads);
+
+    CHECK(!first.empty());
+    CHECK(first == again);
+    CHECK(first == single);
+    CHECK(premiums == premiums_again);
+    CHECK(premiums == premiums_single);
+
+    const auto reference_keys = strategy_keys(enumerate_strategies(test_case.max_legs, test_case.filter));
+    const std::set<std::vector<int>> found_keys(first.begin(), first.end());
+    CHECK(found_keys.size() == first.size());
+    CHECK(std::includes(reference_keys.begin(), reference_keys.end(),
+                        found_keys.begin(), found_keys.end()));
+}
+
+int main() {
+    check_generator(GeneratorMode::DFS, "dfs");
+    check_generator(GeneratorMode::MITM, "mitm");
+    check_generator(GeneratorMode::CLIQUE, "clique");
+    check_beam_determinism();
+    return test_result("test_generators");
+}
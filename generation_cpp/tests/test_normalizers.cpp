@@ -0,0 +1,124 @@
+/**
+ * Tests des normaliseurs de rang (percentile, robust): quantiles publiés par
+ * l'énumération à partir des sketches par thread, précision du sketch, rejet
+ * sans quantiles et incompatibilité avec keep_session.
+ */
+
+#include "bindings.cpp"
+#include "test_support.hpp"
+
+#include <stdexcept>
+
+static const int MAX_LEGS = 4;
+
+// Plusieurs milliers de valides: le sketch compacte ses niveaux
+static FilterParams wide_filter() {
+    return FilterParams{8.0, 8.0, 2.0, 2, 2, 0.2, -0.5, 0.5, 90.0, 110.0};
+}
+
+// Métriques par défaut, average_pnl en percentile et sigma_pnl en robust
+static std::vector<MetricConfig> rank_metrics() {
+    std::vector<MetricConfig> metrics = StrategyScorer::create_default_metrics();
+    for (auto& metric : metrics) {
+        if (metric.name == "average_pnl") {
+            metric.normalizer = NormalizerType::PERCENTILE;
+        } else if (metric.name == "sigma_pnl") {
+            metric.normalizer = NormalizerType::ROBUST;
+        }
+    }
+    return metrics;
+}
+
+/**
+ * Quantiles publiés pour les seules métriques de rang, sur tout l'ensemble
+ * valide, à ~1 % de rang près des quantiles exacts
+ */
+static void check_published_quantiles(GeneratorMode generator, int n_threads) {
+    load_synthetic_cache(12);
+    omp_set_num_threads(n_threads);
+
+    std::vector<MetricConfig> metrics = rank_metrics();
+    const std::vector<ScoredStrategy> valid = enumerate_strategies(
+        MAX_LEGS, wide_filter(), nullptr, nullptr, 0, nullptr, generator, nullptr, &metrics);
+    CHECK(valid.size() > 1000);
+
+    for (const auto& metric : metrics) {
+        if (!StrategyScorer::is_rank_normalizer(metric.normalizer)) {
+            CHECK(!metric.quantiles);
+            continue;
+        }
+        CHECK(metric.quantiles);
+        if (!metric.quantiles) {
+            continue;
+        }
+        CHECK(metric.quantiles->count() == valid.size());
+
+        std::vector<double> column;
+        for (const auto& strat : valid) {
+            column.push_back(StrategyScorer::metric_value(strat, metric));
+        }
+        std::sort(column.begin(), column.end());
+        for (double q : {0.05, 0.25, 0.5, 0.75, 0.95}) {
+            const double value = metric.quantiles->quantile(q);
+            const auto below = std::upper_bound(column.begin(), column.end(), value) - column.begin();
+            CHECK_NEAR(static_cast<double>(below) / column.size(), q, 0.02);
+        }
+    }
+}
+
+/**
+ * Ranking avec les quantiles publiés: scores dans [0, 1], triés. Sans
+ * quantiles, le ranking est refusé.
+ */
+static void check_rank_scoring() {
+    load_synthetic_cache(12);
+
+    std::vector<MetricConfig> metrics = rank_metrics();
+    std::vector<ScoredStrategy> valid = enumerate_strategies(
+        MAX_LEGS, wide_filter(), nullptr, nullptr, 0, nullptr, GeneratorMode::MASKS, nullptr, &metrics);
+
+    std::vector<ScoredStrategy> unpublished = valid;
+    std::vector<ScoredStrategy> ranked = StrategyScorer::score_and_rank(valid, metrics, 50);
+    CHECK(ranked.size() == 50);
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        CHECK(ranked[i].score >= 0.0 && ranked[i].score <= 1.0);
+        CHECK(i == 0 || ranked[i - 1].score >= ranked[i].score);
+    }
+
+    bool thrown = false;
+    try {
+        StrategyScorer::score_and_rank(unpublished, rank_metrics(), 50);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+static bool session_options_throw(bool keep_session, bool custom_metrics, bool normalizers) {
+    try {
+        check_session_options(keep_session, custom_metrics, normalizers);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+// normalizers et custom_metrics: refusés avec keep_session uniquement
+static void check_session_incompatibility() {
+    CHECK(session_options_throw(true, false, true));
+    CHECK(session_options_throw(true, true, false));
+    CHECK(!session_options_throw(true, false, false));
+    CHECK(!session_options_throw(false, true, true));
+}
+
+int main() {
+    const int max_threads = omp_get_max_threads();
+    check_published_quantiles(GeneratorMode::MASKS, 1);
+    check_published_quantiles(GeneratorMode::MASKS, std::max(max_threads, 4));
+    check_published_quantiles(GeneratorMode::DFS, std::max(max_threads, 4));
+    omp_set_num_threads(max_threads);
+
+    check_rank_scoring();
+    check_session_incompatibility();
+    return test_result("test_normalizers");
+}
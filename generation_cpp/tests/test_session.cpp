@@ -0,0 +1,264 @@
+/**
+ * Tests du store de session: rescore (nouveaux poids) et refilter (seuils
+ * resserrés, relâchés ou les deux) reproduisent un run complet, sans
+ * ré-énumérer; score_decomposition se re-pondère comme le store.
+ */
+
+#include "bindings.cpp"
+#include "test_support.hpp"
+
+#include <map>
+
+static const int MAX_LEGS = 4;
+static const int TOP_N = 20;
+
+// Filtre du run initial (bornes larges, plusieurs milliers de valides)
+static FilterParams session_filter() {
+    return FilterParams{8.0, 8.0, 2.0, 2, 2, 0.2, -0.5, 0.5, 90.0, 110.0};
+}
+
+// Métriques par défaut avec certains poids remplacés (comme custom_weights)
+static std::vector<MetricConfig> weighted_metrics(const std::map<std::string, double>& weights) {
+    std::vector<MetricConfig> metrics = StrategyScorer::create_default_metrics();
+    for (auto& metric : metrics) {
+        const auto it = weights.find(metric.name);
+        if (it != weights.end()) {
+            metric.weight = it->second;
+        }
+    }
+    return metrics;
+}
+
+// Run complet: énumération, scoring, ranking et doublons exacts
+static std::vector<ScoredStrategy> fresh_run(const FilterParams& filter,
+                                             const std::vector<MetricConfig>& metrics) {
+    std::vector<ScoredStrategy> valid = enumerate_strategies(MAX_LEGS, filter);
+    std::vector<ScoredStrategy> ranked = StrategyScorer::score_and_rank(valid, metrics, TOP_N);
+    return StrategyScorer::remove_duplicates(ranked, 4, TOP_N);
+}
+
+// Run keep_session=True, session_max_rows=0: store complet et journal des rejets
+static void start_session(const FilterParams& filter) {
+    std::vector<RejectionLog> rejections;
+    const std::vector<ScoredStrategy> valid = enumerate_strategies(MAX_LEGS, filter, &rejections);
+    g_session.build(valid, g_cache.options, filter, 0, std::move(rejections));
+}
+
+/**
+ * Même classement qu'un run complet. Le store classe un pool plus large
+ * avant les doublons: le résultat du run complet en est un préfixe. Les
+ * doublons exacts départagés différemment ont le même payoff, comparé
+ * point par point.
+ */
+static void check_same_ranking(const std::vector<ScoredStrategy>& session,
+                               const std::vector<ScoredStrategy>& fresh) {
+    CHECK(!fresh.empty());
+    CHECK(fresh.size() <= session.size());
+    CHECK(session.size() <= static_cast<size_t>(TOP_N));
+    const size_t n = std::min(session.size(), fresh.size());
+    for (size_t i = 0; i < n; ++i) {
+        CHECK_NEAR(session[i].score, fresh[i].score, 1e-9);
+        CHECK(session[i].rank == static_cast<int>(i + 1));
+        CHECK(session[i].total_pnl_array.size() == fresh[i].total_pnl_array.size());
+        for (size_t g = 0; g < session[i].total_pnl_array.size(); ++g) {
+            CHECK_NEAR(session[i].total_pnl_array[g], fresh[i].total_pnl_array[g], 1e-9);
+        }
+    }
+}
+
+static const std::vector<std::map<std::string, double>>& weight_profiles() {
+    static const std::vector<std::map<std::string, double>> profiles = {
+        {},
+        {{"average_pnl", 1.0}},
+        {{"sigma_pnl", 0.5}, {"delta_neutral", 0.3}, {"average_pnl", 0.05}},
+        {{"implied_vol_moderate", 0.4}, {"roll", 0.0}, {"roll_quarterly", 0.0}},
+        {{"avg_pnl_levrage", 0.6}, {"gamma_low", 0.2}},
+    };
+    return profiles;
+}
+
+/**
+ * rescore: chaque profil de poids classé sur le store = run complet
+ */
+static void check_rescore() {
+    load_synthetic_cache(12);
+    const FilterParams filter = session_filter();
+    start_session(filter);
+    CHECK(g_session.valid());
+
+    for (const auto& profile : weight_profiles()) {
+        const std::vector<MetricConfig> metrics = weighted_metrics(profile);
+        check_same_ranking(rank_session_strategies(metrics, TOP_N), fresh_run(filter, metrics));
+    }
+}
+
+// Ensemble des stratégies du store de session
+static std::set<std::vector<int>> session_keys() {
+    std::set<std::vector<int>> keys;
+    std::vector<int> indices, signs;
+    for (size_t row = 0; row < g_session.size(); ++row) {
+        g_session.legs(row, indices, signs);
+        keys.insert(legs_key(indices, signs));
+    }
+    return keys;
+}
+
+struct RefilterCase {
+    const char* name;
+    FilterParams filter;
+};
+
+// Mêmes limit_left / limit_right que le run initial (sinon run complet)
+static std::vector<RefilterCase> refilter_cases() {
+    const FilterParams base = session_filter();
+    std::vector<RefilterCase> cases;
+
+    FilterParams tightened = base;
+    tightened.max_loss_left = 3.0;
+    tightened.max_premium_params = 1.0;
+    tightened.delta_min = -0.2;
+    tightened.ouvert_droite = 1;
+    cases.push_back({"resserré", tightened});
+
+    FilterParams relaxed = base;
+    relaxed.max_loss_right = 15.0;
+    relaxed.max_premium_params = 4.0;
+    relaxed.delta_max = 0.9;
+    relaxed.min_premium_sell = 0.05;
+    cases.push_back({"relâché", relaxed});
+
+    FilterParams mixed = base;
+    mixed.max_loss_left = 20.0;
+    mixed.max_loss_right = 4.0;
+    mixed.delta_min = -1.0;
+    mixed.delta_max = 0.2;
+    mixed.ouvert_gauche = 1;
+    mixed.ouvert_droite = 3;
+    cases.push_back({"mixte", mixed});
+
+    return cases;
+}
+
+/**
+ * refilter: le store refiltré contient exactement l'ensemble valide d'une
+ * énumération avec le nouveau filtre, et se classe comme un run complet.
+ * Un second refiltre repart d'un store et d'un journal déjà modifiés.
+ */
+static void check_refilter() {
+    load_synthetic_cache(12);
+    const std::vector<MetricConfig> metrics = weighted_metrics({});
+
+    for (const auto& test_case : refilter_cases()) {
+        start_session(session_filter());
+        CHECK(g_session.can_refilter());
+
+        std::vector<FilterParams> steps = {test_case.filter, session_filter()};
+        for (const FilterParams& filter : steps) {
+            refilter_session(filter);
+
+            const auto reference_keys = strategy_keys(enumerate_strategies(MAX_LEGS, filter));
+            const auto keys = session_keys();
+            if (keys != reference_keys) {
+                std::fprintf(stderr, "refilter %s: %zu stratégies, référence %zu\n",
+                             test_case.name, keys.size(), reference_keys.size());
+            }
+            CHECK(!reference_keys.empty());
+            CHECK(keys == reference_keys);
+            CHECK(keys.size() == g_session.size());
+            check_same_ranking(rank_session_strategies(metrics, TOP_N), fresh_run(filter, metrics));
+        }
+    }
+}
+
+// Poids normalisés d'un profil, dans l'ordre des colonnes de la décomposition
+static std::vector<double> profile_weights(const std::map<std::string, double>& profile,
+                                           const std::vector<std::string>& metric_names) {
+    std::vector<MetricConfig> metrics = weighted_metrics(profile);
+    StrategyScorer::normalize_weights(metrics);
+    std::vector<double> weights;
+    for (const auto& name : metric_names) {
+        const auto it = std::find_if(metrics.begin(), metrics.end(),
+            [&](const MetricConfig& metric) { return metric.name == name; });
+        weights.push_back(it != metrics.end() ? it->weight : 0.0);
+    }
+    return weights;
+}
+
+/**
+ * score_decomposition: scores = sub_scores . poids, top_k identique au
+ * classement du store, aucune ligne hors top_k au-dessus de la borne de
+ * promotion, et re-tri local exact quand la borne le garantit
+ */
+static void check_decomposition() {
+    load_synthetic_cache(12);
+    start_session(session_filter());
+
+    // Environ la moitié du store: la borne de promotion est atteinte pour certains profils
+    const int top_k = 3000;
+    const std::vector<MetricConfig> metrics = weighted_metrics({});
+    const ScoreDecomposition decomposition = g_session.decompose(metrics, top_k);
+    const size_t n_metrics = decomposition.metric_names.size();
+    CHECK(decomposition.rows.size() == static_cast<size_t>(top_k));
+    CHECK(decomposition.sub_scores.size() == decomposition.rows.size() * n_metrics);
+
+    const auto ranked = g_session.rank(metrics, top_k);
+    CHECK(ranked.size() == decomposition.rows.size());
+    for (size_t i = 0; i < decomposition.rows.size() && i < ranked.size(); ++i) {
+        double score = 0.0;
+        for (size_t j = 0; j < n_metrics; ++j) {
+            score += decomposition.sub_scores[i * n_metrics + j] * decomposition.weights[j];
+        }
+        CHECK_NEAR(score, decomposition.scores[i], 1e-9);
+        CHECK(decomposition.rows[i] == ranked[i].first);
+        CHECK_NEAR(decomposition.scores[i], ranked[i].second, 1e-9);
+    }
+    CHECK_NEAR(rank_session_strategies(metrics, TOP_N).front().score, decomposition.scores.front(), 1e-9);
+
+    // Re-pondération locale pour chaque profil
+    const std::set<size_t> top_rows(decomposition.rows.begin(), decomposition.rows.end());
+    int exact_profiles = 0;
+    for (const auto& profile : weight_profiles()) {
+        const std::vector<double> weights = profile_weights(profile, decomposition.metric_names);
+        double promotion_bound = 0.0;
+        for (size_t j = 0; j < n_metrics; ++j) {
+            promotion_bound += weights[j] * decomposition.outside_max[j];
+        }
+
+        // Aucune ligne hors top_k au-dessus de la borne
+        const auto all_rows = g_session.rank(weighted_metrics(profile), static_cast<int>(g_session.size()));
+        CHECK(all_rows.size() == g_session.size());
+        for (const auto& [row, score] : all_rows) {
+            if (top_rows.count(row) == 0) {
+                CHECK(score <= promotion_bound + 1e-9);
+            }
+        }
+
+        std::vector<std::pair<double, size_t>> local;
+        for (size_t i = 0; i < decomposition.rows.size(); ++i) {
+            double score = 0.0;
+            for (size_t j = 0; j < n_metrics; ++j) {
+                score += decomposition.sub_scores[i * n_metrics + j] * weights[j];
+            }
+            local.push_back({score, decomposition.rows[i]});
+        }
+        std::stable_sort(local.begin(), local.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+        if (local[TOP_N - 1].first < promotion_bound) {
+            continue;
+        }
+
+        ++exact_profiles;
+        for (int i = 0; i < TOP_N; ++i) {
+            CHECK(local[i].second == all_rows[i].first);
+            CHECK_NEAR(local[i].first, all_rows[i].second, 1e-9);
+        }
+    }
+    CHECK(exact_profiles > 0);
+}
+
+int main() {
+    check_rescore();
+    check_refilter();
+    check_decomposition();
+    return test_result("test_session");
+}
@@ -0,0 +1,118 @@
+/**
+ * Outils communs des tests C++ - Header
+ * Univers synthétique chargé dans le cache global et assertions minimales.
+ * À inclure après bindings.cpp (g_cache, g_session, enumerate_strategies).
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+
+// ============================================================================
+// ASSERTIONS
+// ============================================================================
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            ++g_failures; \
+            std::fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    do { \
+        const double check_a_ = (a); \
+        const double check_b_ = (b); \
+        if (!(std::abs(check_a_ - check_b_) <= (tolerance))) { \
+            ++g_failures; \
+            std::fprintf(stderr, "%s:%d: échec: %s = %g, %s = %g\n", \
+                         __FILE__, __LINE__, #a, check_a_, #b, check_b_); \
+        } \
+    } while (0)
+
+// Code de sortie ctest
+inline int test_result(const char* name) {
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%s: %d échec(s)\n", name, g_failures);
+        return 1;
+    }
+    std::printf("%s: OK\n", name);
+    return 0;
+}
+
+// ============================================================================
+// UNIVERS SYNTHÉTIQUE
+// ============================================================================
+
+/**
+ * Charge dans g_cache n_strikes strikes par échéance, un call puis un put par
+ * strike (ordre de TickerBuilder), avec des P&L à l'expiration sur une grille
+ * de prix et des grecs/cotations tirés d'une graine fixe. Comme
+ * init_options_cache, vide le store de session.
+ */
+inline void load_synthetic_cache(int n_strikes, int n_expiries = 1, uint32_t seed = 11) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const size_t grid = 120;
+    g_session.clear();
+    g_cache = OptionsCache();
+    g_cache.pnl_length = grid;
+    g_cache.average_mix = 100.0;
+    for (size_t g = 0; g < grid; ++g) {
+        g_cache.prices.push_back(80.0 + 0.33 * static_cast<double>(g));
+    }
+    g_cache.mixture.assign(grid, 1.0 / grid);
+
+    for (int expiry = 0; expiry < n_expiries; ++expiry) {
+        for (int k = 0; k < n_strikes; ++k) {
+            for (int type = 0; type < 2; ++type) {
+                OptionData option{};
+                option.is_call = type == 0;
+                option.strike = 88.0 + 2.0 * k;
+                option.expiry = expiry;
+                option.premium = 0.1 + 3.0 * unit(rng);
+                option.delta = (option.is_call ? 1.0 : -1.0) * 0.6 * unit(rng);
+                option.gamma = 0.05 * unit(rng);
+                option.vega = 0.2 * unit(rng);
+                option.theta = -0.05 * unit(rng);
+                option.implied_volatility = 0.1 + 0.3 * unit(rng);
+                option.average_pnl = unit(rng) - 0.5;
+                option.sigma_pnl = 0.5 + unit(rng);
+                option.open_interest = 100.0 * unit(rng);
+                option.bid = option.premium - 0.05 * unit(rng);
+                option.ask = option.premium + 0.05 * unit(rng);
+
+                std::vector<double> pnl(grid);
+                for (size_t g = 0; g < grid; ++g) {
+                    const double spot = g_cache.prices[g];
+                    const double payoff = option.is_call
+                        ? std::max(spot - option.strike, 0.0)
+                        : std::max(option.strike - spot, 0.0);
+                    pnl[g] = payoff - option.premium;
+                }
+                g_cache.options.push_back(option);
+                g_cache.pnl_matrix.push_back(std::move(pnl));
+            }
+        }
+    }
+
+    g_cache.n_options = g_cache.options.size();
+    build_contract_index(g_cache);
+    g_cache.valid = true;
+}
+
+// Ensemble des stratégies (jambes et signes), indépendant de l'ordre de sortie
+inline std::set<std::vector<int>> strategy_keys(const std::vector<ScoredStrategy>& strategies) {
+    std::set<std::vector<int>> keys;
+    for (const auto& strat : strategies) {
+        keys.insert(legs_key(strat.option_indices, strat.signs));
+    }
+    return keys;
+}
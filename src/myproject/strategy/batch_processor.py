@@ -3,7 +3,7 @@ Batch Processor C++ pour le traitement des combinaisons d'options
 """
 
 import numpy as np
-from typing import Dict, List, Tuple, Optional 
+from typing import Any, Dict, List, Tuple, Optional 
 import strategy_metrics_cpp
 
 from myproject.option.option_class import Option
@@ -16,6 +16,9 @@ from myproject.app.filter_widget import FilterData
 # Cache global pour stocker les options (nécessaire pour batch_to_strategies)
 _options_cache: List[Option] = []
 
+# Codes mois Bloomberg dans l'ordre chronologique
+_MONTH_ORDER = "FGHJKMNQUVXZ"
+
 
 # =============================================================================
 # INITIALISATION DU CACHE C++
@@ -58,6 +61,24 @@ def init_cpp_cache(options: List[Option]) -> bool:
     rolls_quarterly = np.array([opt.roll_quarterly or 0.0 for opt in options], dtype=np.float64)
     rolls_sum = np.array([opt.roll_sum or 0.0 for opt in options], dtype=np.float64)
     
+    # Données de liquidité (0 si inconnues)
+    open_interests = np.array([opt.open_interest or 0 for opt in options], dtype=np.float64)
+    volumes = np.array([opt.volume or 0 for opt in options], dtype=np.float64)
+    bid_sizes = np.array([opt.bid_size or 0 for opt in options], dtype=np.float64)
+    ask_sizes = np.array([opt.ask_size or 0 for opt in options], dtype=np.float64)
+    
+    # Cotations pour l'exécution bid/ask (0 si inconnues: premium mid)
+    bids = np.array([opt.bid or 0.0 for opt in options], dtype=np.float64)
+    asks = np.array([opt.ask or 0.0 for opt in options], dtype=np.float64)
+    
+    # Échéances: rang chronologique de (année, mois) parmi les échéances présentes
+    expiry_keys = sorted({(opt.expiration_year, _MONTH_ORDER.find(opt.expiration_month)) for opt in options})
+    expiry_rank = {key: rank for rank, key in enumerate(expiry_keys)}
+    expiries = np.array(
+        [expiry_rank[(opt.expiration_year, _MONTH_ORDER.find(opt.expiration_month))] for opt in options],
+        dtype=np.int32
+    )
+    
     # Matrice P&L
     pnl_matrix = np.zeros((n, pnl_length), dtype=np.float64)
     for i, opt in enumerate(options):
@@ -74,7 +95,10 @@ def init_cpp_cache(options: List[Option]) -> bool:
         premiums, deltas, gammas, vegas, thetas, ivs,
         average_pnls, sigma_pnls, strikes,
         is_calls, rolls, rolls_quarterly, rolls_sum,
-        pnl_matrix, prices, mixture, average_mix
+        pnl_matrix, prices, mixture, average_mix,
+        open_interests=open_interests, volumes=volumes,
+        bid_sizes=bid_sizes, ask_sizes=ask_sizes,
+        bids=bids, asks=asks, expiries=expiries
     )
     
     return True
@@ -87,11 +111,16 @@ def process_batch_cpp_with_scoring(
     n_legs: int,
     filter: FilterData,
     top_n: int = 5,
-    custom_weights: Optional[Dict[str, float]] = None
+    custom_weights: Optional[Dict[str, float]] = None,
+    **engine_options: Any
 ) -> List[StrategyComparison]:
     """
     Traite un batch de combinaisons via le module C++ AVEC scoring et ranking.
 
+    Args:
+        engine_options: Options avancées transmises telles quelles au moteur C++
+            (ex: dedup_mode="linf", dedup_tolerance=0.0025, expiry_policy="single")
+
     Returns:
         Liste de StrategyComparison pour les top_n stratégies (défaut: 5)
     """
@@ -115,7 +144,8 @@ def process_batch_cpp_with_scoring(
         filter.limit_left,
         filter.limit_right,
         top_n,
-        weights_dict
+        weights_dict,
+        **engine_options
     )
     strategies = batch_to_strategies(raw_results, _options_cache)
 
@@ -123,6 +153,140 @@ def process_batch_cpp_with_scoring(
     return strategies
 
 
+def process_batch_cpp_multi_profile(
+    n_legs: int,
+    filter: FilterData,
+    weight_profiles: List[Dict[str, float]],
+    top_n: int = 5,
+    **engine_options: Any
+) -> List[List[StrategyComparison]]:
+    """
+    Une seule énumération C++ pour plusieurs profils de poids
+    (ex: income, neutral, directional).
+
+    Args:
+        engine_options: Options transmises telles quelles au moteur C++
+            (ex: liquidity={"min_open_interest": 100}, use_bid_ask=True)
+
+    Returns:
+        Une liste de StrategyComparison par profil, dans l'ordre de weight_profiles
+    """
+    global _options_cache
+    
+    if not _options_cache:
+        raise RuntimeError("Options cache is empty. Call init_cpp_cache() first.")
+    
+    raw_results = strategy_metrics_cpp.process_combinations_batch_multi_profile(  # type: ignore
+        n_legs,
+        filter.max_loss_left,
+        filter.max_loss_right,
+        filter.max_premium,
+        filter.ouvert_gauche,
+        filter.ouvert_droite,
+        filter.min_premium_sell,
+        filter.delta_min,
+        filter.delta_max,
+        filter.limit_left,
+        filter.limit_right,
+        [profile if profile else {} for profile in weight_profiles],
+        top_n,
+        **engine_options
+    )
+    return [batch_to_strategies(profile_results, _options_cache) for profile_results in raw_results]
+
+
+def rescore_cpp(
+    top_n: int = 5,
+    custom_weights: Optional[Dict[str, float]] = None
+) -> List[StrategyComparison]:
+    """
+    Re-classe le dernier run C++ avec de nouveaux poids, sans ré-énumérer.
+    Nécessite un appel préalable avec keep_session=True.
+
+    Returns:
+        Liste de StrategyComparison pour les top_n stratégies
+    """
+    global _options_cache
+    
+    if not _options_cache:
+        raise RuntimeError("Options cache is empty. Call init_cpp_cache() first.")
+    
+    weights_dict = custom_weights if custom_weights else {}
+    
+    raw_results = strategy_metrics_cpp.rescore(weights_dict, top_n)  # type: ignore
+    return batch_to_strategies(raw_results, _options_cache)
+
+
+def score_decomposition_cpp(
+    top_k: int = 1000,
+    custom_weights: Optional[Dict[str, float]] = None
+) -> Dict[str, Any]:
+    """
+    Sous-scores par métrique des top_k stratégies du dernier run C++
+    (keep_session=True), pour re-pondérer localement avec reweight_decomposition.
+    """
+    weights_dict = custom_weights if custom_weights else {}
+    return strategy_metrics_cpp.score_decomposition(weights_dict, top_k)  # type: ignore
+
+
+def reweight_decomposition(
+    decomposition: Dict[str, Any],
+    weights: Dict[str, float],
+    top_n: int = 5
+) -> Tuple[np.ndarray, bool]:
+    """
+    Re-trie localement les top_k d'une décomposition pour de nouveaux poids.
+
+    Returns:
+        (positions des top_n dans la décomposition, exact). exact=False: une
+        stratégie hors top_k peut dépasser le top_n, relancer rescore_cpp.
+    """
+    w = np.array([weights.get(name, 0.0) for name in decomposition["metrics"]], dtype=np.float64)
+    scores = decomposition["sub_scores"] @ w
+    order = np.argsort(-scores, kind="stable")[:top_n]
+    if len(order) == 0:
+        return order, True
+    exact = bool(scores[order[-1]] >= decomposition["outside_max"] @ w)
+    return order, exact
+
+
+def refilter_cpp(
+    filter: FilterData,
+    top_n: int = 5,
+    custom_weights: Optional[Dict[str, float]] = None
+) -> List[StrategyComparison]:
+    """
+    Applique de nouveaux seuils de filtre au dernier run C++ sans ré-énumérer.
+    Nécessite un appel préalable avec keep_session=True (store complet).
+    Modifier limit_left / limit_right relance un run complet côté C++.
+
+    Returns:
+        Liste de StrategyComparison pour les top_n stratégies
+    """
+    global _options_cache
+    
+    if not _options_cache:
+        raise RuntimeError("Options cache is empty. Call init_cpp_cache() first.")
+    
+    weights_dict = custom_weights if custom_weights else {}
+    
+    raw_results = strategy_metrics_cpp.refilter(  # type: ignore
+        filter.max_loss_left,
+        filter.max_loss_right,
+        filter.max_premium,
+        filter.ouvert_gauche,
+        filter.ouvert_droite,
+        filter.min_premium_sell,
+        filter.delta_min,
+        filter.delta_max,
+        filter.limit_left,
+        filter.limit_right,
+        top_n,
+        weights_dict
+    )
+    return batch_to_strategies(raw_results, _options_cache)
+
+
 # =============================================================================
 # CONVERSION DES RESULTATS
 # =============================================================================
@@ -6,7 +6,7 @@ GÃ©nÃ¨re toutes les combinaisons de stratÃ©gies d'options via le module C+
 Le traitement est entiÃ¨rement dÃ©lÃ©guÃ© au batch processor C++ pour des performances optimales.
 """
 
-from typing import List, Tuple, Optional, Dict
+from typing import Any, List, Tuple, Optional, Dict
 from myproject.option.option_class import Option
 from myproject.strategy.strategy_class import StrategyComparison
 from myproject.strategy.batch_processor import process_batch_cpp_with_scoring, init_cpp_cache
@@ -33,14 +33,16 @@ class OptionStrategyGeneratorV2:
         filter: FilterData,
         max_legs: int = 4,
         top_n: int = 10,
-        custom_weights: Optional[Dict[str, float]] = None
+        custom_weights: Optional[Dict[str, float]] = None,
+        **engine_options: Any
     ) -> List[StrategyComparison]:
 
         strategies = process_batch_cpp_with_scoring(
             max_legs,
             filter,
             top_n=top_n,
-            custom_weights=custom_weights
+            custom_weights=custom_weights,
+            **engine_options
         )
         return strategies
 